@@ -8,7 +8,9 @@ CONFIG_DIR="$HOME/.config/mint-dwm/config"
 KEYS=$(cat <<'EOF'
 基础操作
 Super + Space         启动应用菜单
+Super + d             内置启动器 (PATH 与 .desktop 模糊搜索)
 Super + Return        打开终端
+Super + x             切换 scratchpad 终端
 Super + e             打开文件管理器
 Super + w             打开浏览器
 Super + Shift + w     切换壁纸
@@ -17,8 +19,10 @@ Super + a             截图 (复制到剪贴板)
 Super + Shift + a     截图 (复制并保存)
 Super + Shift + l     锁屏
 Super + Shift + q     退出 dwm
+Super + Shift + r     重新加载 Xresources 主题
 窗口管理
 Super + ` / Shift + ` 聚焦下一个/上一个窗口
+Alt + Tab / Shift+Tab  按最近使用顺序切换窗口 (跨标签)
 Super + , / .         减小/增大主窗口区域
 Super + s             交换主窗口 (Zoom)
 Super + q             关闭当前窗口
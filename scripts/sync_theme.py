@@ -2,6 +2,7 @@
 import os
 import re
 import shutil
+import subprocess
 
 # Paths
 # Adjust these relative to where the script is located or use absolute paths
@@ -317,6 +318,16 @@ def update_alacritty(colors):
     with open(ALACRITTY, 'w') as f:
         f.writelines(new_lines)
 
+def reload_dwm():
+    """合并新的 Xresources 并通知正在运行的 dwm 重新加载 (SIGUSR1)，无需重启"""
+    try:
+        subprocess.run(["xrdb", "-merge", XRESOURCES], check=True)
+    except (OSError, subprocess.CalledProcessError) as e:
+        print(f"Warning: xrdb 合并失败: {e}")
+        return
+    if subprocess.run(["pkill", "-USR1", "-x", "dwm"]).returncode == 0:
+        print("已通知 dwm 重新加载主题。")
+
 def main():
     theme_files = list_themes()
     if not theme_files:
@@ -339,6 +350,7 @@ def main():
     update_dunstrc(colors)
     update_rofi(colors)
     update_alacritty(colors)
+    reload_dwm()
     print("Theme sync completed successfully.")
 
 if __name__ == "__main__":
@@ -0,0 +1,229 @@
+/* See LICENSE file for copyright and license details.
+ *
+ * dwmbench - synthetic X client measuring dwm event handling latency.
+ *
+ * Meant to run against a dwm built with -DBENCH (see "make bench"), which
+ * answers a _DWM_BENCH client message on the root window by storing its
+ * own X request counter in the _DWM_BENCH root property. Since dwm handles
+ * events strictly in order, the PropertyNotify for that answer doubles as
+ * a fence: everything sent before it has been processed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <X11/Xatom.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#include "util.h"
+
+enum { BenchFence, BenchView }; /* _DWM_BENCH opcodes, see dwm.c */
+
+typedef struct {
+	const char *name;
+	long *lat;                  /* microseconds */
+	size_t n, cap;
+	unsigned long reqs;         /* X requests issued by dwm */
+} Scenario;
+
+static Display *dpy;
+static Window root;
+static Atom benchatom, wmpid, wintype, wintypedialog;
+
+static long
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+static void
+record(Scenario *s, long us)
+{
+	if (s->n == s->cap) {
+		s->cap = s->cap ? s->cap * 2 : 256;
+		if (!(s->lat = realloc(s->lat, s->cap * sizeof(long))))
+			die("realloc:");
+	}
+	s->lat[s->n++] = us;
+}
+
+static int
+cmplong(const void *a, const void *b)
+{
+	long x = *(const long *)a, y = *(const long *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void
+report(Scenario *s)
+{
+	long sum = 0;
+	size_t i;
+
+	if (!s->n)
+		return;
+	qsort(s->lat, s->n, sizeof(long), cmplong);
+	for (i = 0; i < s->n; i++)
+		sum += s->lat[i];
+	printf("%-14s n=%-5zu min=%-6ld p50=%-6ld p90=%-6ld p99=%-6ld max=%-7ld avg=%-6ld "
+	       "reqs=%-6lu reqs/op=%.1f\n", s->name, s->n, s->lat[0],
+	       s->lat[s->n / 2], s->lat[s->n * 9 / 10], s->lat[s->n * 99 / 100],
+	       s->lat[s->n - 1], sum / (long)s->n, s->reqs, (double)s->reqs / s->n);
+}
+
+/* send an opcode to dwm and wait until it has been handled;
+ * returns dwm's request counter at that point */
+static unsigned long
+bench(long op, long arg)
+{
+	XEvent ev = { .type = ClientMessage };
+	Atom da;
+	int di;
+	unsigned long dl, n, seq = 0;
+	unsigned char *p = NULL;
+
+	ev.xclient.window = root;
+	ev.xclient.message_type = benchatom;
+	ev.xclient.format = 32;
+	ev.xclient.data.l[0] = op;
+	ev.xclient.data.l[1] = arg;
+	XSendEvent(dpy, root, False, SubstructureRedirectMask|SubstructureNotifyMask, &ev);
+	do
+		XWindowEvent(dpy, root, PropertyChangeMask, &ev);
+	while (ev.xproperty.atom != benchatom);
+	if (XGetWindowProperty(dpy, root, benchatom, 0, 1, False, XA_CARDINAL,
+		&da, &di, &n, &dl, &p) == Success && p) {
+		if (n == 1)
+			seq = *(unsigned long *)p;
+		XFree(p);
+	}
+	return seq;
+}
+
+static void
+waitfor(Window w, int type)
+{
+	XEvent ev;
+
+	do
+		XWindowEvent(dpy, w, StructureNotifyMask, &ev);
+	while (ev.type != type);
+}
+
+static Window
+mkwin(int i, int dialog)
+{
+	Window w;
+	XClassHint ch = { "dwmbench", "DwmBench" };
+	char name[32];
+	long pid = 0;
+
+	w = XCreateSimpleWindow(dpy, root, 0, 0, 400, 300, 0, 0, 0);
+	snprintf(name, sizeof name, "dwmbench %d", i);
+	XStoreName(dpy, w, name);
+	XSetClassHint(dpy, w, &ch);
+	XChangeProperty(dpy, w, wmpid, XA_CARDINAL, 32, PropModeReplace,
+		(unsigned char *)&pid, 1);
+	if (dialog)
+		XChangeProperty(dpy, w, wintype, XA_ATOM, 32, PropModeReplace,
+			(unsigned char *)&wintypedialog, 1);
+	XSelectInput(dpy, w, StructureNotifyMask);
+	return w;
+}
+
+int
+main(int argc, char *argv[])
+{
+	Scenario map = { "map-storm" }, title = { "title-spam" },
+	         tags = { "tag-switch" }, drag = { "resize-drag" },
+	         unmap = { "destroy-storm" };
+	Window *wins, dlg;
+	char name[64];
+	unsigned long seq;
+	long t;
+	int i, n = argc > 1 ? atoi(argv[1]) : 50, rounds = argc > 2 ? atoi(argv[2]) : 500;
+
+	if (n < 1 || rounds < 1)
+		die("usage: dwmbench [clients] [rounds]");
+	if (!(dpy = XOpenDisplay(NULL)))
+		die("dwmbench: cannot open display");
+	root = DefaultRootWindow(dpy);
+	benchatom = XInternAtom(dpy, "_DWM_BENCH", False);
+	wmpid = XInternAtom(dpy, "_NET_WM_PID", False);
+	wintype = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE", False);
+	wintypedialog = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_DIALOG", False);
+	XSelectInput(dpy, root, PropertyChangeMask);
+	wins = ecalloc(n, sizeof(Window));
+
+	/* mapping storm: MapRequest -> manage() -> arrange() for every client */
+	for (i = 0; i < n; i++)
+		wins[i] = mkwin(i, 0);
+	seq = bench(BenchFence, 0);
+	for (i = 0; i < n; i++) {
+		t = now();
+		XMapWindow(dpy, wins[i]);
+		waitfor(wins[i], MapNotify);
+		record(&map, now() - t);
+	}
+	map.reqs = bench(BenchFence, 0) - seq - 1;
+
+	/* title spam: PropertyNotify -> updatetitle() -> drawbar() */
+	seq = bench(BenchFence, 0);
+	for (i = 0; i < rounds; i++) {
+		snprintf(name, sizeof name, "dwmbench title %d", i);
+		t = now();
+		XStoreName(dpy, wins[n - 1], name);
+		bench(BenchFence, 0);
+		record(&title, now() - t);
+	}
+	title.reqs = bench(BenchFence, 0) - seq - 1 - rounds;
+
+	/* rapid tag switching: view() -> showhide() + arrange() + restack() */
+	seq = bench(BenchFence, 0);
+	for (i = 0; i < rounds; i++) {
+		t = now();
+		bench(BenchView, 1L << (i % 2));
+		record(&tags, now() - t);
+	}
+	tags.reqs = bench(BenchFence, 0) - seq - 1 - rounds;
+	bench(BenchView, 1);
+
+	/* resize drag of a floating client: ConfigureRequest round trips */
+	dlg = mkwin(n, 1);
+	XMapWindow(dpy, dlg);
+	waitfor(dlg, MapNotify);
+	seq = bench(BenchFence, 0);
+	for (i = 0; i < rounds; i++) {
+		t = now();
+		XMoveResizeWindow(dpy, dlg, 100, 100, 300 + i % 400, 200 + i % 300);
+		waitfor(dlg, ConfigureNotify);
+		record(&drag, now() - t);
+	}
+	drag.reqs = bench(BenchFence, 0) - seq - 1;
+	XDestroyWindow(dpy, dlg);
+
+	/* destroy storm: DestroyNotify -> unmanage() -> arrange() */
+	seq = bench(BenchFence, 0);
+	for (i = 0; i < n; i++) {
+		t = now();
+		XDestroyWindow(dpy, wins[i]);
+		bench(BenchFence, 0);
+		record(&unmap, now() - t);
+	}
+	unmap.reqs = bench(BenchFence, 0) - seq - 1 - n;
+
+	printf("dwmbench: %d clients, %d rounds, latencies in microseconds\n", n, rounds);
+	report(&map);
+	report(&title);
+	report(&tags);
+	report(&drag);
+	report(&unmap);
+
+	XCloseDisplay(dpy);
+	return EXIT_SUCCESS;
+}
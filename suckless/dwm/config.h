@@ -19,6 +19,8 @@ static int showbar            = 1;        /* 0 表示不显示状态栏 */
 static int topbar             = 1;        /* 0 表示状态栏在底部 */
 static int focusedontoptiled  = 1;        /* 1 means focused tile client is shown on top of floating windows */
 static int focusonhover       = 0;        /* 1: 鼠标悬停切换焦点, 0: 不自动切换 */
+static int showclientstats    = 1;        /* 1: 标题右侧显示焦点窗口进程树的 CPU 与内存 */
+static const unsigned int clientstatsinterval = 2000; /* 进程资源采样间隔（毫秒），0 = 关闭 */
 static int barheight          = 30;        /* 0 表示自动高度 */
 static unsigned int tagunderlineheight = 2; /* 选中标签下指示器的高度 */
 static unsigned int tagunderlinepad    = 4; /* 指示器的水平内边距 */
@@ -50,45 +52,62 @@ static char *colors[][3]      = {
 /* tagging */
 static const char *tags[] = { "", "", "3", "", "", "󰠟", "󰟀", "", "󰓦" };
 
+/* scratchpads: 启动时预先在后台运行，切换时无需重新启动；关闭后自动在后台重新启动 */
+static const char *spterm[] = { "st", "-n", "spterm", "-g", "120x34", NULL };
+static const Sp scratchpads[] = {
+	/* name       cmd */
+	{ "spterm",   spterm },
+};
+
 static const Rule rules[] = {
 	/* xprop(1):
 	 *	WM_CLASS(STRING) = instance, class
 	 *	WM_NAME(STRING) = title
 	 */
-	/* class                instance    title       tags mask     isfloating monitor  height_percent  aspect_ratio  center */
+	/* class                instance    title       tags mask     isfloating monitor  height_percent  aspect_ratio  center  freezehidden */
 	/* height_percent: 0.0 = 使用默认值, >0.0 = 屏幕高度的百分比 (例如, 0.8 = 80%) */
 	/* aspect_ratio: 0.0 = 使用默认值, >0.0 = 宽高比 (例如, 16.0/9.0 = 1.777) */
 	/* center: 0 = 不居中, 1 = 居中浮动窗口 */
+	/* freezehidden: 1 = 所在标签隐藏 freezegrace 秒后对其进程树发送 SIGSTOP，显示前 SIGCONT */
 	/* 注意: 浮动窗口默认 alwaysontop，无需在规则中指定 */
+	/* scratchpad 通过 instance 匹配，tags 使用 SPTAG(n) */
+	{ NULL,                                   "spterm",                               NULL,                       SPTAG(0), 1, -1, 0.6, 0.0,    1,  0 },
 	/* brave app YutubeMusic */
-	{ NULL,                                   "crx_cinhimbnkkaeohfgghhklpknlkffjgod", NULL,                       1 << 7, 0, -1, 0.0, 0.0,      0 },
+	{ NULL,                                   "crx_cinhimbnkkaeohfgghhklpknlkffjgod", NULL,                       1 << 7, 0, -1, 0.0, 0.0,      0,  0 },
 	/* brave app Youtube */
-	{ NULL,                                   "crx_agimnkijcaahngcdmfeangaknmldooml", NULL,                       1 << 7, 0, -1, 0.0, 0.0,      0 },
-	{ "Virt-manager",                         NULL,                                   NULL,                       1 << 6, 0, -1, 0.0, 0.0,      0 },
-	// { "Brave-browser",                        NULL,                                   NULL,                       1 << 0, 0, -1, 0.0, 0.0,      0 },
-	{ "Cursor",                               NULL,                                   NULL,                       1 << 1, 0, -1, 0.0, 0.0,      0 },
-	{ "FreeFileSync",                         NULL,                                   NULL,                       1 << 8, 0, -1, 0.0, 0.0,      0 },
-	{ "Localsend",                            "localsend",                            NULL,                       1 << 8, 0, -1, 0.0, 0.0,      0 },
-	{ "Rofi",                                 NULL,                                   NULL,                       0,      1, -1, 0.0, 0.0,      1 },
-	{ "zenity",                               NULL,                                   NULL,                       0,      1, -1, 0.0, 0.0,      1 },
-	{ "Bulky.py",                             "bulky.py",                             NULL,                       0,      1, -1, 0.0, 0.0,      1 },
-	{ "mpv",                                  NULL,                                   NULL,                       0,      1, -1, 0.0, 0.0, 	   1 },
-	{ "feh",                                  NULL,                                   NULL,                       0,      1, -1, 0.0, 0.0,      1 },
-	{ "com.github.qarmin.czkawka",            NULL,                                   NULL,                       1 << 8, 0, -1, 0.0, 0.0,      0 },
-	{ "Thunar",                               "thunar",                               "Confirm to replace files", 0,      1, -1, 0.0, 0.0,      1 },
-	{ "Thunar",                               "thunar",                               "Rename",                   0,      1, -1, 0.0, 0.0,      1 },
-	{ "Thunar",                               "thunar",                               "File Operation Progress",  0,      1, -1, 0.0, 0.0,      1 },
-	{ "org.gnome.FileRoller",                 "org.gnome.FileRoller",                 NULL,                       0,      1, -1, 0.0, 0.0,      1 },
-	{ "tdxcfv",                               "tdxw.fak",                             NULL,                       1 << 5, 0, -1, 0.0, 0.0,      0 },
-	{ "Xfce4-appfinder",                      "xfce4-appfinder",                      NULL,                       0,      1, -1, 0.4, 0.0,      1 },
-	{ "Io.github.celluloid_player.Celluloid", NULL,                                   NULL,                       0,      1, -1, 0.0, 0.0,      1 },
-	{ "Xviewer",                              NULL,                                   NULL,                       0,      1, -1, 0.0, 0.0,      1 },
-	{ "fr.handbrake.ghb",                     NULL,                                   NULL,                       1 << 4, 0, -1, 0.0, 0.0,      0 },
-	{ "CherryStudio",                     	  NULL,                                   NULL,                       1 << 3, 0, -1, 0.0, 0.0,      0 },
-	{ "Motrix",                               NULL,                                   NULL,                       0,      1, -1, 0.0, 0.0,      1 },
+	{ NULL,                                   "crx_agimnkijcaahngcdmfeangaknmldooml", NULL,                       1 << 7, 0, -1, 0.0, 0.0,      0,  0 },
+	{ "Virt-manager",                         NULL,                                   NULL,                       1 << 6, 0, -1, 0.0, 0.0,      0,  0 },
+	// { "Brave-browser",                        NULL,                                   NULL,                       1 << 0, 0, -1, 0.0, 0.0,      0,  0 },
+	{ "Cursor",                               NULL,                                   NULL,                       1 << 1, 0, -1, 0.0, 0.0,      0,  0 },
+	{ "FreeFileSync",                         NULL,                                   NULL,                       1 << 8, 0, -1, 0.0, 0.0,      0,  0 },
+	{ "Localsend",                            "localsend",                            NULL,                       1 << 8, 0, -1, 0.0, 0.0,      0,  0 },
+	{ "Rofi",                                 NULL,                                   NULL,                       0,      1, -1, 0.0, 0.0,      1,  0 },
+	{ "zenity",                               NULL,                                   NULL,                       0,      1, -1, 0.0, 0.0,      1,  0 },
+	{ "Bulky.py",                             "bulky.py",                             NULL,                       0,      1, -1, 0.0, 0.0,      1,  0 },
+	{ "mpv",                                  NULL,                                   NULL,                       0,      1, -1, 0.0, 0.0, 	   1,  0 },
+	{ "feh",                                  NULL,                                   NULL,                       0,      1, -1, 0.0, 0.0,      1,  0 },
+	{ "com.github.qarmin.czkawka",            NULL,                                   NULL,                       1 << 8, 0, -1, 0.0, 0.0,      0,  0 },
+	{ "Thunar",                               "thunar",                               "Confirm to replace files", 0,      1, -1, 0.0, 0.0,      1,  0 },
+	{ "Thunar",                               "thunar",                               "Rename",                   0,      1, -1, 0.0, 0.0,      1,  0 },
+	{ "Thunar",                               "thunar",                               "File Operation Progress",  0,      1, -1, 0.0, 0.0,      1,  0 },
+	{ "org.gnome.FileRoller",                 "org.gnome.FileRoller",                 NULL,                       0,      1, -1, 0.0, 0.0,      1,  0 },
+	{ "tdxcfv",                               "tdxw.fak",                             NULL,                       1 << 5, 0, -1, 0.0, 0.0,      0,  0 },
+	{ "Xfce4-appfinder",                      "xfce4-appfinder",                      NULL,                       0,      1, -1, 0.4, 0.0,      1,  0 },
+	{ "Io.github.celluloid_player.Celluloid", NULL,                                   NULL,                       0,      1, -1, 0.0, 0.0,      1,  0 },
+	{ "Xviewer",                              NULL,                                   NULL,                       0,      1, -1, 0.0, 0.0,      1,  0 },
+	{ "fr.handbrake.ghb",                     NULL,                                   NULL,                       1 << 4, 0, -1, 0.0, 0.0,      0,  0 },
+	{ "CherryStudio",                     	  NULL,                                   NULL,                       1 << 3, 0, -1, 0.0, 0.0,      0,  1 },
+	{ "Motrix",                               NULL,                                   NULL,                       0,      1, -1, 0.0, 0.0,      1,  0 },
 
 };
 
+static const unsigned int freezegrace = 30; /* 隐藏多少秒后冻结 freezehidden 窗口 */
+
+/* 焦点窗口进程提权，离开焦点时恢复 */
+static const int focusnice = 5;                /* nice 值降低多少，0 = 关闭 (需要 CAP_SYS_NICE 或 RLIMIT_NICE) */
+static const int focusioprio = 0;              /* best-effort I/O 优先级 0..7，-1 = 关闭 */
+static const unsigned int focuscpuweight = 400; /* 已委派的独立 cgroup 的 cpu.weight，0 = 关闭 (默认 100) */
+
 /* layout(s) */
 static float mfact     = 0.55; /* 主区域大小因子 [0.05..0.95] */
 static int nmaster     = 1;    /* 主区域中的客户端数量 */
@@ -121,15 +140,20 @@ static const Layout layouts[] = {
 
 
 /* commands */
-#define SCRIPTS_DIR "$HOME/.config/mint-dwm/scripts/"
-#define CONFIG_DIR  "$HOME/.config/mint-dwm/config/"
+/* 命令直接通过 posix_spawn 执行，不经过 /bin/sh；argv[0] 开头的 "~/" 会展开为 $HOME */
+/* 需要 shell 语法时使用 SHCMD() */
+#define SCRIPTS_DIR "~/.config/mint-dwm/scripts/"
+#define CONFIG_DIR  "~/.config/mint-dwm/config/"
 
 static char dmenumon[2] = "0"; /* component of dmenucmd, manipulated in spawn() */
-static const char *launchercmd[] = { "/bin/sh", "-c", SCRIPTS_DIR "run-launcher.sh", NULL };
+static const char *launchercmd[] = { SCRIPTS_DIR "run-launcher.sh", NULL };
+static const unsigned int launcherlines = 12;          /* 内置启动器显示的候选行数 */
+static const unsigned int switcherlines = 12;          /* Alt+Tab 窗口切换器最多显示的行数 */
+static const char *launcherterm[] = { "st", "-e", NULL }; /* Terminal=true 的 .desktop 程序用它启动 */
 static const char *dmenucmd[] = { "dmenu_run", "-m", dmenumon, "-fn", dmenufont, "-nb", normbgcolor, "-nf", normfgcolor, "-sb", accentcolor, "-sf", normbgcolor, NULL };
-static const char *termcmd[]  = { "/bin/sh", "-c", SCRIPTS_DIR "run-term.sh", NULL };
+static const char *termcmd[]  = { SCRIPTS_DIR "run-term.sh", NULL };
 
-/* Xresources preferences to load at startup */
+/* Xresources preferences, loaded at startup and on xrdb()/SIGUSR1 */
 ResourcePref resources[] = {
 		{ "font",               STRING,  &font },
 		{ "dmenufont",          STRING,  &dmenufont },
@@ -166,20 +190,21 @@ ResourcePref resources[] = {
 		{ "systrayiconsize",    INTEGER, &systrayiconsize },
 		{ "showsystray",        INTEGER, &showsystray },
 		{ "focusonhover",       INTEGER, &focusonhover },
+		{ "showclientstats",    INTEGER, &showclientstats },
 };
 static const char *filecmd[]  = { "/usr/bin/nemo",  NULL };
-static const char *screenshotcmd[]  = { "/bin/sh", "-c", SCRIPTS_DIR "screenshot.sh copy", NULL };
-static const char *screenshotsavedcmd[] = { "/bin/sh", "-c", SCRIPTS_DIR "screenshot.sh save", NULL };
-static const char *wallpapercmd[]  = { "/bin/sh", "-c", SCRIPTS_DIR "wallpaper-next.sh", NULL };
-static const char *browsercmd[]  = { "/bin/sh", "-c", SCRIPTS_DIR "run-brave.sh", NULL };
-static const char *slockcmd[]  = { "/bin/sh", "-c", "slock", NULL };
-static const char *fsearchcmd[]  = { "/bin/sh", "-c", SCRIPTS_DIR "run-fsearch.sh", NULL };
-static const char *upvol[]   = { "/bin/sh", "-c", SCRIPTS_DIR "volume.sh up",   NULL };
-static const char *downvol[] = { "/bin/sh", "-c", SCRIPTS_DIR "volume.sh down", NULL };
-static const char *mutevol[] = { "/bin/sh", "-c", SCRIPTS_DIR "volume.sh mute", NULL };
-static const char *sysact[] = { "/bin/sh", "-c", SCRIPTS_DIR "sysact.sh", NULL };
-static const char *clipman[] = { "/bin/sh", "-c", "xfce4-clipman-history", NULL };
-static const char *showkeyscmd[] = { "/bin/sh", "-c", SCRIPTS_DIR "show-keys.sh", NULL };
+static const char *screenshotcmd[]  = { SCRIPTS_DIR "screenshot.sh", "copy", NULL };
+static const char *screenshotsavedcmd[] = { SCRIPTS_DIR "screenshot.sh", "save", NULL };
+static const char *wallpapercmd[]  = { SCRIPTS_DIR "wallpaper-next.sh", NULL };
+static const char *browsercmd[]  = { SCRIPTS_DIR "run-brave.sh", NULL };
+static const char *slockcmd[]  = { "slock", NULL };
+static const char *fsearchcmd[]  = { SCRIPTS_DIR "run-fsearch.sh", NULL };
+static const char *upvol[]   = { SCRIPTS_DIR "volume.sh", "up",   NULL };
+static const char *downvol[] = { SCRIPTS_DIR "volume.sh", "down", NULL };
+static const char *mutevol[] = { SCRIPTS_DIR "volume.sh", "mute", NULL };
+static const char *sysact[] = { SCRIPTS_DIR "sysact.sh", NULL };
+static const char *clipman[] = { "xfce4-clipman-history", NULL };
+static const char *showkeyscmd[] = { SCRIPTS_DIR "show-keys.sh", NULL };
 
 
 /* autostart */
@@ -196,6 +221,7 @@ static const AppKey appkeys[] = {
 static const Key keys[] = {
 	/* modifier                     key        function        argument */
 	{ MODKEY,                       XK_space,  spawn,          {.v = launchercmd } }, /* 启动菜单 */
+	{ MODKEY,                       XK_d,      launcher,       {0} }, /* 内置启动器 */
 	{ MODKEY,                       XK_Return, spawn,          {.v = termcmd } }, /* 启动终端 */
     { MODKEY,                       XK_e,      spawn,          {.v = filecmd } }, /* 启动thunar */
     { MODKEY,                       XK_a,      spawn,          {.v = screenshotcmd } }, /* 截图 */
@@ -206,6 +232,7 @@ static const Key keys[] = {
 	{ MODKEY,                       XK_f,      spawn,          {.v = fsearchcmd } }, /* 搜索 */
 	{ MODKEY,                       XK_v,      spawn,          {.v = clipman } }, /* 剪贴板 */
 	{ MODKEY,                       XK_h,      spawn,          {.v = showkeyscmd } }, /* 快捷键帮助 */
+	{ MODKEY,                       XK_x,      togglescratch,  {.ui = 0 } }, /* 切换 scratchpad 终端 */
 	{ 0,                            XF86XK_AudioMute,        spawn, {.v = mutevol } },
 	{ 0,                            XF86XK_AudioLowerVolume, spawn, {.v = downvol } },
 	{ 0,                            XF86XK_AudioRaiseVolume, spawn, {.v = upvol } },
@@ -222,6 +249,8 @@ static const Key keys[] = {
 	{ MODKEY,                       XK_0,      togglegaps,     {0} }, /* 切换间距 */
 	{ MODKEY|ShiftMask,             XK_0,      defaultgaps,    {0} }, /* 恢复默认间距 */
 	{ MODKEY,                       XK_Tab,    viewnexttag,    {0} }, /* 切换到下一个标签 */
+	{ Mod1Mask,                     XK_Tab,    switcher,       {.i = +1 } }, /* 按最近使用顺序切换窗口，松开 Alt 确认 */
+	{ Mod1Mask|ShiftMask,           XK_Tab,    switcher,       {.i = -1 } }, /* 反向切换 */
 	{ MODKEY,            		    XK_q,      killclient,     {0} }, /* 关闭当前窗口 */
 	{ MODKEY,            			XK_m,  	   cyclelayout,    {.i = +1} }, /* 循环切换布局 */
 	{ MODKEY,            			XK_t,  	   setlayout,      {.v = &layouts[0]} }, /* 强制切换回 Tile 布局 */
@@ -234,6 +263,7 @@ static const Key keys[] = {
 	TAGKEYS(                        XK_7,                      6)
 	TAGKEYS(                        XK_8,                      7)
 	TAGKEYS(                        XK_9,                      8)
+	{ MODKEY|ShiftMask,             XK_r,      xrdb,           {0} }, /* 重新加载 Xresources (也可 pkill -USR1 dwm) */
 	{ MODKEY|ShiftMask,             XK_q,      quit,           {0} },
 };
 
@@ -20,16 +20,29 @@
  *
  * To understand everything else, start reading main().
  */
+#include <ctype.h>
+#include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <locale.h>
 #include <signal.h>
+#include <spawn.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <sys/syscall.h>
+#endif /* __linux__ */
 #include <X11/cursorfont.h>
 #include <X11/keysym.h>
 #include <X11/Xatom.h>
@@ -55,8 +68,16 @@
 #define MOUSEMASK               (BUTTONMASK|PointerMotionMask)
 #define WIDTH(X)                ((X)->w + 2 * (X)->bw)
 #define HEIGHT(X)               ((X)->h + 2 * (X)->bw)
-#define TAGMASK                 ((1 << LENGTH(tags)) - 1)
+#define NUMTAGS                 (LENGTH(tags) + LENGTH(scratchpads))
+#define TAGMASK                 ((1 << NUMTAGS) - 1)
+#define SPTAG(i)                ((1 << LENGTH(tags)) << (i))
+#define SPTAGMASK               (((1 << LENGTH(scratchpads)) - 1) << LENGTH(tags))
 #define TEXTW(X)                (drw_fontset_getwidth(drw, (X)) + lrpad)
+#define SPAWNBUCKETS            16  /* log2 millisecond buckets, last one open-ended */
+#define EVLOGMAGIC              "DWMEVLG1"
+#define IOPRIO_WHO_PROCESS      1
+#define IOPRIO_PRIO_VALUE(c, l) ((c) << 13 | (l))
+#define IOPRIO_CLASS_BE         2
 
 #define SYSTEM_TRAY_REQUEST_DOCK    0
 /* XEMBED messages */
@@ -77,11 +98,13 @@ enum { SchemeNorm, SchemeSel, SchemeOcc, SchemeSelOcc, SchemeUnderline }; /* col
 enum { NetSupported, NetWMName, NetWMState, NetWMCheck,
        NetSystemTray, NetSystemTrayOP, NetSystemTrayOrientation, NetSystemTrayOrientationHorz,
        NetWMFullscreen, NetActiveWindow, NetWMWindowType,
-       NetWMWindowTypeDialog, NetClientList, NetLast }; /* EWMH atoms */
+       NetWMWindowTypeDialog, NetClientList, NetWMPid, NetLast }; /* EWMH atoms */
 enum { Manager, Xembed, XembedInfo, XLast }; /* Xembed atoms */
 enum { WMProtocols, WMDelete, WMState, WMTakeFocus, WMLast }; /* default atoms */
 enum { ClkTagBar, ClkLtSymbol, ClkStatusText, ClkWinTitle,
        ClkClientWin, ClkRootWin, ClkLast }; /* clicks */
+enum { EvAtom, EvAlias, EvKey }; /* event log meta records, X uses 0 and 1 for errors/replies */
+enum { AliasRoot, AliasBar, AliasSystray, AliasCheck }; /* EvAlias kinds */
 
 typedef union {
 	int i;
@@ -113,6 +136,12 @@ struct Client {
 	float rule_height_percent;  /* height percentage from rule */
 	float rule_aspect_ratio;    /* aspect ratio from rule */
 	int rule_center;            /* center window from rule */
+	int freezehidden, frozen;   /* see Rule.freezehidden */
+	long hiddensince;           /* msec() when it was hidden, 0 while shown */
+	float cpu;                  /* CPU% of its process tree, see procsample() */
+	unsigned long rss;          /* resident set of its process tree in KiB */
+	pid_t pid;                  /* _NET_WM_PID, 0 if unknown */
+	unsigned long focusseq;     /* focusclock when last focused, for the MRU switcher */
 	Client *next;
 	Client *snext;
 	Monitor *mon;
@@ -163,6 +192,8 @@ struct Monitor {
 	Monitor *next;
 	Window barwin;
 	const Layout *lt[2];
+	Window *order;        /* stacking order last applied by restack(), top first */
+	int norder, ordercap;
 };
 
 typedef struct {
@@ -175,6 +206,7 @@ typedef struct {
 	float height_percent;  /* height percentage of screen (0.0 = use default, >0.0 = use this percentage) */
 	float aspect_ratio;    /* width/height ratio (0.0 = use default, >0.0 = maintain this ratio) */
 	int center;            /* center floating window (0 = no, 1 = yes) */
+	int freezehidden;      /* SIGSTOP the client's processes while it is hidden */
 } Rule;
 
 /* Xresources preferences */
@@ -190,6 +222,68 @@ typedef struct {
 	void *dst;
 } ResourcePref;
 
+typedef struct {
+	const char *name;
+	const void *cmd;
+} Sp;
+
+typedef struct {
+	const void *cmd;            /* argv as passed to spawn() */
+	char label[48];
+	unsigned int n;
+	long min, max, sum;         /* milliseconds */
+	unsigned int hist[SPAWNBUCKETS];
+} SpawnStat;
+
+typedef struct {
+	pid_t pid;
+	struct timespec start;
+	SpawnStat *stat;
+} PendingSpawn;
+
+typedef struct {
+	uint32_t dt;                /* microseconds since the previous record */
+	uint8_t type;               /* X event type or EvAtom/EvAlias/EvKey */
+	uint8_t pad;
+	uint16_t len;               /* payload bytes that follow */
+} EvRecord;
+
+typedef struct {
+	char *name;                 /* shown and matched */
+	char *exec;                 /* .desktop command line, NULL for $PATH entries */
+} LaunchItem;
+
+typedef struct {
+	char *path;
+	int desktop;                /* holds .desktop files instead of executables */
+	int wd;                     /* inotify watch, -1 if none */
+	int dirty;
+	time_t mtime;
+	LaunchItem *items;
+	size_t n, cap;
+} LaunchDir;
+
+typedef struct {
+	LaunchItem *item;
+	int score;
+	int dir;
+} LaunchMatch;
+
+typedef struct {
+	pid_t pid;                  /* thread id on Linux */
+	int nice, ioprio;           /* values before the boost */
+} BoostProc;
+
+typedef struct {
+	pid_t pid, ppid;
+	pid_t root;                 /* client process whose tree it is in, 0 if none */
+	unsigned long long ticks;   /* utime + stime at the last read */
+	unsigned long long prev;    /* and at the read before */
+	unsigned long rss;          /* resident pages */
+	unsigned int gen;           /* last /proc listing it was seen in */
+	int fresh;                  /* no current reading to diff against */
+} ProcEnt;
+
 typedef struct Systray   Systray;
 struct Systray {
 	Window win;
@@ -198,16 +292,21 @@ struct Systray {
 
 /* function declarations */
 static void applyrules(Client *c);
+#ifdef BENCH
+static void benchmessage(XClientMessageEvent *cme);
+#endif /* BENCH */
 static int applysizehints(Client *c, int *x, int *y, int *w, int *h, int interact);
 static void arrange(Monitor *m);
 static void arrangemon(Monitor *m);
 static void attach(Client *c);
 static void attachaside(Client *c);
 static void attachstack(Client *c);
+static void boostsync(void);
 static void buttonpress(XEvent *e);
 static void checkotherwm(void);
 static void cleanup(void);
 static void cleanupmon(Monitor *mon);
+static const char *clientstats(Client *c);
 static void clientmessage(XEvent *e);
 static void configure(Client *c);
 static void configurenotify(XEvent *e);
@@ -227,15 +326,26 @@ static void focus(Client *c);
 static void focusin(XEvent *e);
 static void focusmon(const Arg *arg);
 static void focusstack(const Arg *arg);
+static void freeze(pid_t pid, int stop);
+static long freezecheck(void);
 static Atom getatomprop(Client *c, Atom prop);
 static int getrootptr(int *x, int *y);
 static long getstate(Window w);
 static unsigned int getsystraywidth();
 static int gettextprop(Window w, Atom atom, char *text, unsigned int size);
+static pid_t winpid(Window w);
 static void grabbuttons(Client *c, int focused);
 static void grabkeys(void);
 static void incnmaster(const Arg *arg);
 static void keypress(XEvent *e);
+static void keyrelease(XEvent *e);
+static void launcher(const Arg *arg);
+static void launchcleanup(void);
+static void launchdraw(void);
+static void launchinit(void);
+static void launchkey(XKeyEvent *ev);
+static void launchrescan(void);
+static void launchwatch(void);
 static void killclient(const Arg *arg);
 static void manage(Window w, XWindowAttributes *wa);
 static void mappingnotify(XEvent *e);
@@ -248,7 +358,6 @@ static Client *nexttiled(Client *c);
 static void pop(Client *c);
 static void propertynotify(XEvent *e);
 static void quit(const Arg *arg);
-static void raiseclient(Client *c);
 static Monitor *recttomon(int x, int y, int w, int h);
 static void removesystrayicon(Client *i);
 static void resize(Client *c, int x, int y, int w, int h, int interact);
@@ -259,6 +368,9 @@ static void resizerequest(XEvent *e);
 static void restack(Monitor *m);
 static void run(void);
 static void runAutostart(void);
+static void evlogopen(const char *path);
+static void evlogwrite(XEvent *ev);
+static void evreplay(const char *path);
 static void scan(void);
 static int sendevent(Window w, Atom proto, int m, long d0, long d1, long d2, long d3, long d4);
 static void sendmon(Client *c, Monitor *m);
@@ -271,11 +383,24 @@ static void resetmfact(const Arg *arg);
 static void setup(void);
 static void seturgent(Client *c, int urg);
 static void showhide(Client *c);
+static void switcher(const Arg *arg);
+static void switcherdraw(void);
+static void switcherkey(XKeyEvent *ev);
+static void switcherrelease(XKeyEvent *ev);
+static void switcherremove(Client *c);
 static void spawn(const Arg *arg);
+static pid_t spawnv(const char *const argv[]);
+static void spawnlatency(Client *c);
+static void spawnstatsdump(void);
+static void spawnscratch(unsigned int i);
+static void spawnscratchpads(void);
+static long msec(void);
+static long procsample(void);
 static Monitor *systraytomon(Monitor *m);
 static void tag(const Arg *arg);
 static void tagandview(const Arg *arg);
 static void tagmon(const Arg *arg);
+static void togglescratch(const Arg *arg);
 static void tile(Monitor *m);
 static void togglebar(const Arg *arg);
 static void togglefloating(const Arg *arg);
@@ -309,8 +434,11 @@ static int xerrorstart(Display *dpy, XErrorEvent *ee);
 static void zoom(const Arg *arg);
 static void load_xresources(void);
 static void resource_load(XrmDatabase db, char *name, enum resource_type rtype, void *dst);
+static void sigwake(int sig);
+static void xrdb(const Arg *arg);
 
 /* variables */
+extern char **environ;
 static Systray *systray = NULL;
 static const char broken[] = "broken";
 static char stext[1024];
@@ -330,6 +458,7 @@ static void (*handler[LASTEvent]) (XEvent *) = {
 	[Expose] = expose,
 	[FocusIn] = focusin,
 	[KeyPress] = keypress,
+	[KeyRelease] = keyrelease,
 	[MappingNotify] = mappingnotify,
 	[MapRequest] = maprequest,
 	[MotionNotify] = motionnotify,
@@ -347,12 +476,67 @@ static Fnt *statusfontset = NULL;
 static Fnt *tagsfontset = NULL;
 static Monitor *mons, *selmon;
 static Window root, wmcheckwin;
+#ifdef BENCH
+static Atom benchatom;
+#endif /* BENCH */
+static Fnt *mainfontset = NULL;
+static int sigpipe[2] = { -1, -1 }; /* self-pipe waking run() on signals */
+static volatile sig_atomic_t reloadpending = 0;
+static volatile sig_atomic_t statspending = 0;
+static SpawnStat spawnstats[32];
+static FILE *evlog;
+static int replaying;        /* bindings must not start or kill anything */
+static PendingSpawn pendingspawns[16];
+static Window overlaywin;    /* launcher prompt and window switcher */
+static unsigned int overlayw, overlayh;
+static LaunchDir *launchdirs;
+static size_t nlaunchdirs;
+static int inotifyfd = -1;
+static int launchpending;    /* some launcher directory needs a rescan */
+static struct {
+	int open;
+	char text[256];
+	size_t len;
+	LaunchMatch *match;
+	size_t nmatch, cap, sel;
+} launch;
+static struct {
+	pid_t want;                 /* process of the focused client */
+	pid_t pid;                  /* process currently boosted */
+	pid_t sid;                  /* and its session */
+	BoostProc *procs;
+	size_t n;
+	char cgroup[512];           /* boosted cgroup's cpu.weight, "" if none */
+	char weight[16];            /* its previous value */
+} boost;
+static struct {
+	ProcEnt *p;                 /* sorted by pid */
+	size_t n, cap;
+	unsigned int gen;
+	size_t cursor;              /* next entry to read, the pass is split in slices */
+	int busy;                   /* a pass is in progress */
+	long next, last;            /* msec of the next pass and of the previous one */
+} procs;
+static Atom statsatom, utf8string;
+static unsigned long focusclock; /* bumped on every focus change, see Client.focusseq */
+static struct {
+	int open;
+	unsigned int mod;           /* modifier whose release commits */
+	XModifierKeymap *modmap;
+	Client **list;              /* all clients, most recently focused first */
+	size_t n, cap, sel;
+} mru;
 
 /* configuration, allows nested code to access above variables */
 #include "config.h"
 
 /* compile-time check if all tags fit into an unsigned int bit array. */
-struct NumTags { char limitexceeded[LENGTH(tags) > 31 ? -1 : 1]; };
+struct NumTags { char limitexceeded[NUMTAGS > 31 ? -1 : 1]; };
+
+static struct {
+	time_t last;                /* last (re)spawn */
+	int pending;                /* spawned, window not managed yet */
+} spstate[LENGTH(scratchpads)];
 
 /* function implementations */
 void
@@ -370,6 +554,7 @@ applyrules(Client *c)
 	c->rule_height_percent = 0.0;
 	c->rule_aspect_ratio = 0.0;
 	c->rule_center = 0;
+	c->freezehidden = 0;
 	XGetClassHint(dpy, c->win, &ch);
 	class    = ch.res_class ? ch.res_class : broken;
 	instance = ch.res_name  ? ch.res_name  : broken;
@@ -385,6 +570,7 @@ applyrules(Client *c)
 			c->rule_height_percent = r->height_percent;
 			c->rule_aspect_ratio = r->aspect_ratio;
 			c->rule_center = r->center;
+			c->freezehidden = r->freezehidden;
 			for (m = mons; m && m->num != r->monitor; m = m->next);
 			if (m)
 				c->mon = m;
@@ -399,7 +585,7 @@ applyrules(Client *c)
 		XFree(ch.res_class);
 	if (ch.res_name)
 		XFree(ch.res_name);
-	c->tags = c->tags & TAGMASK ? c->tags & TAGMASK : c->mon->tagset[c->mon->seltags];
+	c->tags = c->tags & TAGMASK ? c->tags & TAGMASK : c->mon->tagset[c->mon->seltags] & ~SPTAGMASK;
 }
 
 int
@@ -572,6 +758,22 @@ buttonpress(XEvent *e)
 			buttons[i].func(click == ClkTagBar && buttons[i].arg.i == 0 ? &arg : &buttons[i].arg);
 }
 
+#ifdef BENCH
+/* dwmbench fence: optionally act, then publish our request counter; the
+ * resulting PropertyNotify tells bench.c that all prior events are done */
+void
+benchmessage(XClientMessageEvent *cme)
+{
+	long seq;
+
+	if (cme->data.l[0] == 1) /* BenchView */
+		view(&(Arg){ .ui = cme->data.l[1] });
+	seq = NextRequest(dpy);
+	XChangeProperty(dpy, root, benchatom, XA_CARDINAL, 32,
+		PropModeReplace, (unsigned char *)&seq, 1);
+}
+#endif /* BENCH */
+
 void
 checkotherwm(void)
 {
@@ -606,6 +808,9 @@ cleanup(void)
 		free(systray);
 	}
 
+	launchcleanup();
+	boost.want = 0;
+	boostsync();
 	for (i = 0; i < CurLast; i++)
 		drw_cur_free(drw, cursor[i]);
 	for (i = 0; i < LENGTH(colors) + 1; i++)
@@ -616,6 +821,8 @@ cleanup(void)
 	XSync(dpy, False);
 	XSetInputFocus(dpy, PointerRoot, RevertToPointerRoot, CurrentTime);
 	XDeleteProperty(dpy, root, netatom[NetActiveWindow]);
+	if (evlog)
+		fclose(evlog);
 }
 
 void
@@ -631,6 +838,7 @@ cleanupmon(Monitor *mon)
 	}
 	XUnmapWindow(dpy, mon->barwin);
 	XDestroyWindow(dpy, mon->barwin);
+	free(mon->order);
 	free(mon);
 }
 
@@ -643,6 +851,12 @@ clientmessage(XEvent *e)
 	Client *c = wintoclient(cme->window);
 	unsigned int i;
 
+#ifdef BENCH
+	if (cme->window == root && cme->message_type == benchatom) {
+		benchmessage(cme);
+		return;
+	}
+#endif /* BENCH */
 	if (showsystray && cme->window == systray->win && cme->message_type == netatom[NetSystemTrayOP]) {
 		/* add systray icons */
 		if (cme->data.l[1] == SYSTEM_TRAY_REQUEST_DOCK) {
@@ -1010,11 +1224,11 @@ drawstatusbar(Monitor *m, int bh, char* stext) {
 void
 drawbar(Monitor *m)
 {
-	int x, w, tw = 0, stw = 0;
+	int x, w, tw = 0, stw = 0, cw;
 	Fnt *oldfont = drw->fonts;
 	int boxs = oldfont->h / 9;
 	int boxw = oldfont->h / 6 + 2;
-	unsigned int i, occ = 0, urg = 0;
+	unsigned int i, occ = 0, urg = 0, frz = 0;
 	Client *c;
 
 	if (!m->showbar)
@@ -1034,6 +1248,8 @@ drawbar(Monitor *m)
 		occ |= c->tags;
 		if (c->isurgent)
 			urg |= c->tags;
+		if (c->frozen)
+			frz |= c->tags;
 	}
 	x = 0;
 	if (tagsfontset)
@@ -1053,6 +1269,9 @@ drawbar(Monitor *m)
 		w = TEXTW(tags[i]);
 		drw_setscheme(drw, scheme[schemeidx]);
 		drw_text(drw, x, 0, w, bh, lrpad / 2, tags[i], urg & 1 << i);
+		/* 冻结的后台窗口所在标签显示一个空心小方块 */
+		if (frz & 1 << i)
+			drw_rect(drw, x + boxs, boxs, boxw, boxw, 0, urg & 1 << i);
 
 		if (istagselected && tagunderlineheight > 0 && w > (int)(tagunderlinepad * 2))
 		{
@@ -1078,6 +1297,11 @@ drawbar(Monitor *m)
 	if ((w = m->ww - tw - stw - x) > bh) {
 		if (m->sel) {
 			drw_setscheme(drw, scheme[m == selmon ? SchemeSel : SchemeNorm]);
+			if (showclientstats && m->sel->pid && (cw = TEXTW(clientstats(m->sel))) < w / 2) {
+				/* 标题右侧显示进程树的 CPU 与内存占用 */
+				drw_text(drw, x + w - cw, 0, cw, bh, lrpad / 2, clientstats(m->sel), 0);
+				w -= cw;
+			}
 			drw_text(drw, x, 0, w, bh, lrpad / 2, m->sel->name, 0);
 			if (m->sel->isfloating)
 				drw_rect(drw, x + boxs, boxs, boxw, boxw, m->sel->isfixed, 0);
@@ -1129,6 +1353,13 @@ expose(XEvent *e)
 	Monitor *m;
 	XExposeEvent *ev = &e->xexpose;
 
+	if (ev->window == overlaywin) {
+		if (ev->count == 0 && launch.open)
+			launchdraw();
+		else if (ev->count == 0 && mru.open)
+			switcherdraw();
+		return;
+	}
 	if (ev->count == 0 && (m = wintomon(ev->window))) {
 		drawbar(m);
 		if (m == selmon)
@@ -1150,6 +1381,8 @@ focus(Client *c)
 			seturgent(c, 0);
 		detachstack(c);
 		attachstack(c);
+		c->focusseq = ++focusclock;
+		boost.want = c->pid;
 		grabbuttons(c, 1);
 		XSetWindowBorder(dpy, c->win, scheme[SchemeSel][ColBorder].pixel);
 		setfocus(c);
@@ -1299,6 +1532,24 @@ gettextprop(Window w, Atom atom, char *text, unsigned int size)
 	return 1;
 }
 
+pid_t
+winpid(Window w)
+{
+	int di;
+	unsigned long dl, n;
+	unsigned char *p = NULL;
+	Atom da;
+	pid_t pid = 0;
+
+	if (XGetWindowProperty(dpy, w, netatom[NetWMPid], 0L, 1L, False, XA_CARDINAL,
+		&da, &di, &n, &dl, &p) == Success && p) {
+		if (n == 1)
+			pid = *(long *)p;
+		XFree(p);
+	}
+	return pid;
+}
+
 void
 grabbuttons(Client *c, int focused)
 {
@@ -1375,6 +1626,14 @@ keypress(XEvent *e)
 	XKeyEvent *ev;
 
 	ev = &e->xkey;
+	if (launch.open) {
+		launchkey(ev);
+		return;
+	}
+	if (mru.open) {
+		switcherkey(ev);
+		return;
+	}
 	keysym = XKeycodeToKeysym(dpy, (KeyCode)ev->keycode, 0);
 	for (i = 0; i < LENGTH(keys); i++)
 		if (keysym == keys[i].keysym
@@ -1399,10 +1658,17 @@ keypress(XEvent *e)
 	}
 }
 
+void
+keyrelease(XEvent *e)
+{
+	if (mru.open)
+		switcherrelease(&e->xkey);
+}
+
 void
 killclient(const Arg *arg)
 {
-	if (!selmon->sel)
+	if (!selmon->sel || replaying)
 		return;
 
 	if (!sendevent(selmon->sel->win, wmatom[WMDelete], NoEventMask, wmatom[WMDelete], CurrentTime, 0 , 0, 0)) {
@@ -1423,6 +1689,7 @@ manage(Window w, XWindowAttributes *wa)
 	Window trans = None;
 	XWindowChanges wc;
 	XEvent xev;
+	unsigned int i;
 
 	c = ecalloc(1, sizeof(Client));
 	c->win = w;
@@ -1432,6 +1699,7 @@ manage(Window w, XWindowAttributes *wa)
 	c->w = c->oldw = wa->width;
 	c->h = c->oldh = wa->height;
 	c->oldbw = wa->border_width;
+	c->pid = winpid(w);
 
 	updatetitle(c);
 	/* 先检查是否是 transient 窗口 */
@@ -1496,6 +1764,7 @@ manage(Window w, XWindowAttributes *wa)
 		c->x = MAX(c->x, c->mon->wx);
 		c->y = MAX(c->y, c->mon->wy);
 		XRaiseWindow(dpy, c->win);
+		c->mon->norder = 0;
 	}
 	attachaside(c);
 	attachstack(c);
@@ -1506,9 +1775,13 @@ manage(Window w, XWindowAttributes *wa)
 	if (c->mon == selmon)
 		unfocus(selmon->sel, 0);
 	c->mon->sel = c;
+	for (i = 0; i < LENGTH(scratchpads); i++)
+		if (c->tags & SPTAG(i))
+			spstate[i].pending = 0;
 	arrange(c->mon);
 	XMapWindow(dpy, c->win);
 	focus(NULL);
+	spawnlatency(c);
 	while (XCheckMaskEvent(dpy, EnterWindowMask, &xev));
 }
 
@@ -1713,58 +1986,9 @@ propertynotify(XEvent *e)
 void
 quit(const Arg *arg)
 {
-	running = 0;
-}
-
-void
-raiseclient(Client *c)
-{
-	Client *s, *top = NULL;
-	Monitor *m;
-	XWindowChanges wc;
-	int raised = 0;
-
-	/* If the raised client is on the sticky workspace, then refer to the previously
-	 * selected workspace when for searching other clients. */
-	m = c->mon;
-	wc.stack_mode = Above;
-	wc.sibling = m->barwin ? m->barwin : wmcheckwin;
-
-	/* If the raised client is always on top, then it should be raised first. */
-	if (c->alwaysontop && c->isfloating && ISVISIBLE(c)) {
-		top = c;
-		XRaiseWindow(dpy, c->win);
-		wc.stack_mode = Below;
-		wc.sibling = c->win;
-		raised = 1;
-	}
-
-	/* Check if there are floating always on top clients that need to be on top. */
-	for (s = m->stack; s; s = s->snext) {
-		if (s == c || !s->isfloating || !s->alwaysontop || !ISVISIBLE(s))
-			continue;
-
-		if (!top) {
-			top = s;
-			XRaiseWindow(dpy, s->win);
-			wc.stack_mode = Below;
-			wc.sibling = s->win;
-			continue;
-		}
-
-		XConfigureWindow(dpy, s->win, CWSibling|CWStackMode, &wc);
-		wc.sibling = s->win;
-	}
-
-	if (raised)
+	if (replaying)
 		return;
-
-	if (top) {
-		XConfigureWindow(dpy, c->win, CWSibling|CWStackMode, &wc);
-		return;
-	}
-
-	XRaiseWindow(dpy, c->win);
+	running = 0;
 }
 
 Monitor *
@@ -1897,63 +2121,133 @@ resizerequest(XEvent *e)
 void
 restack(Monitor *m)
 {
-	Client *c;
-	Client *raised;
+	static Window *wins;
+	static int cap;
+	static unsigned long lastsync;
+	unsigned long seq = NextRequest(dpy);
+	Client *c, *raised;
 	XEvent ev;
-	XWindowChanges wc;
+	int n = 0;
 
 	drawbar(m);
-	
-	if (m->lt[m->sellt]->arrange) {
-		wc.stack_mode = Below;
-		wc.sibling = m->barwin;
-		for (c = m->stack; c; c = c->snext)
-			if (!c->isfloating && ISVISIBLE(c)) {
-				XConfigureWindow(dpy, c->win, CWSibling|CWStackMode, &wc);
-				wc.sibling = c->win;
-			}
+
+	for (c = m->clients; c; c = c->next, n++);
+	if (n + 2 > cap) {
+		cap = n + 16;
+		if (!(wins = realloc(wins, cap * sizeof(Window))))
+			die("realloc:");
 	}
 
-	if (m->sel) {
-		raised = (focusedontoptiled || m->sel->isfloating ? m->sel : NULL);
-		if (raised)
-			raiseclient(raised);
+	/* 自上而下：置顶浮动窗口、选中窗口、其余浮动窗口、托盘与状态栏、平铺窗口 */
+	n = 0;
+	raised = m->sel && (focusedontoptiled || m->sel->isfloating) ? m->sel : NULL;
+	if (raised && raised->isfloating && raised->alwaysontop)
+		wins[n++] = raised->win;
+	for (c = m->stack; c; c = c->snext)
+		if (c != raised && c->isfloating && c->alwaysontop && ISVISIBLE(c))
+			wins[n++] = c->win;
+	if (raised && !(raised->isfloating && raised->alwaysontop))
+		wins[n++] = raised->win;
+	for (c = m->stack; c; c = c->snext)
+		if (c != raised && c->isfloating && !c->alwaysontop && ISVISIBLE(c))
+			wins[n++] = c->win;
+	/* the systray sits on top of the bar, keep it there */
+	if (showsystray && systray && m == systraytomon(m))
+		wins[n++] = systray->win;
+	wins[n++] = m->barwin;
+	for (c = m->stack; c; c = c->snext)
+		if (c != raised && !c->isfloating && ISVISIBLE(c))
+			wins[n++] = c->win;
+
+	if (n == m->norder && !memcmp(wins, m->order, n * sizeof(Window))) {
+		/* nothing to restack; only sync if something else may have
+		 * generated EnterNotify events since the last time */
+		if (seq == lastsync)
+			return;
 	} else {
-		/* 即使没有选中窗口，也要确保 alwaysontop 窗口被提升 */
-		Client *s, *top = NULL;
-		wc.stack_mode = Above;
-		wc.sibling = m->barwin ? m->barwin : wmcheckwin;
-		
-		for (s = m->stack; s; s = s->snext) {
-			if (!s->isfloating || !s->alwaysontop || !ISVISIBLE(s))
-				continue;
-			
-			if (!top) {
-				top = s;
-				XRaiseWindow(dpy, s->win);
-				wc.stack_mode = Below;
-				wc.sibling = s->win;
-				continue;
-			}
-			
-			XConfigureWindow(dpy, s->win, CWSibling|CWStackMode, &wc);
-			wc.sibling = s->win;
+		if (n > m->ordercap) {
+			m->ordercap = cap;
+			if (!(m->order = realloc(m->order, m->ordercap * sizeof(Window))))
+				die("realloc:");
 		}
+		memcpy(m->order, wins, n * sizeof(Window));
+		m->norder = n;
+		if (wins[0] != m->barwin && !(systray && wins[0] == systray->win))
+			XRaiseWindow(dpy, wins[0]);
+		XRestackWindows(dpy, wins, n);
 	}
-
 	XSync(dpy, False);
 	while (XCheckMaskEvent(dpy, EnterWindowMask, &ev));
+	lastsync = NextRequest(dpy);
 }
 
 void
 run(void)
 {
 	XEvent ev;
+	fd_set rfds;
+	struct timeval tv;
+	char buf[64];
+	int xfd = ConnectionNumber(dpy), nfds, r;
+	long wait;
+
 	/* main event loop */
 	XSync(dpy, False);
-	while (running && !XNextEvent(dpy, &ev))
-		if (handler[ev.type])
-			handler[ev.type](&ev); /* call handler */
+	while (running) {
+		if (XPending(dpy)) {
+			XNextEvent(dpy, &ev);
+			if (evlog)
+				evlogwrite(&ev);
+			if (handler[ev.type])
+				handler[ev.type](&ev); /* call handler */
+			continue;
+		}
+		if (evlog)
+			fflush(evlog);
+		if (boost.want != boost.pid)
+			boostsync();
+		/* queue drained: sleep on the X connection, the signal pipe and
+		 * the launcher's inotify fd */
+		FD_ZERO(&rfds);
+		FD_SET(xfd, &rfds);
+		FD_SET(sigpipe[0], &rfds);
+		nfds = MAX(xfd, sigpipe[0]);
+		if (inotifyfd != -1) {
+			FD_SET(inotifyfd, &rfds);
+			nfds = MAX(nfds, inotifyfd);
+		}
+		/* timers: launcher rescan once directories have been quiet for
+		 * a while, freezing hidden clients after their grace period,
+		 * resource sampling; the latter yields with a zero timeout
+		 * between slices so pending X events always go first */
+		wait = freezecheck();
+		/* the open launcher points into the items a rescan frees */
+		if (launchpending && !launch.open && (wait < 0 || wait > 250))
+			wait = 250;
+		if ((r = procsample()) >= 0 && (wait < 0 || wait > r))
+			wait = r;
+		tv.tv_sec = wait / 1000;
+		tv.tv_usec = wait % 1000 * 1000;
+		if ((r = select(nfds + 1, &rfds, NULL, NULL, wait >= 0 ? &tv : NULL)) == -1) {
+			if (errno == EINTR)
+				continue;
+			die("select:");
+		}
+		if (!r && launchpending && !launch.open)
+			launchrescan();
+		if (inotifyfd != -1 && FD_ISSET(inotifyfd, &rfds))
+			launchwatch();
+		if (FD_ISSET(sigpipe[0], &rfds))
+			while (read(sigpipe[0], buf, sizeof buf) > 0);
+		if (reloadpending) {
+			reloadpending = 0;
+			xrdb(NULL);
+		}
+		if (statspending) {
+			statspending = 0;
+			spawnstatsdump();
+		}
+	}
 }
 
 void
@@ -1992,7 +2286,7 @@ sendmon(Client *c, Monitor *m)
 	detach(c);
 	detachstack(c);
 	c->mon = m;
-	c->tags = m->tagset[m->seltags]; /* assign tags of target monitor */
+	c->tags = m->tagset[m->seltags] & ~SPTAGMASK; /* assign tags of target monitor, scratchpads aside */
 	attachaside(c);
 	attachstack(c);
 	focus(NULL);
@@ -2071,6 +2365,7 @@ setfullscreen(Client *c, int fullscreen)
 		c->alwaysontop = 1;
 		resizeclient(c, c->mon->mx, c->mon->my, c->mon->mw, c->mon->mh);
 		XRaiseWindow(dpy, c->win);
+		c->mon->norder = 0;
 	} else if (!fullscreen && c->isfullscreen){
 		XChangeProperty(dpy, c->win, netatom[NetWMState], XA_ATOM, 32,
 			PropModeReplace, (unsigned char*)0, 0);
@@ -2168,7 +2463,6 @@ setup(void)
 {
 	int i;
 	XSetWindowAttributes wa;
-	Atom utf8string;
 	struct sigaction sa;
 
 	/* do not transform children into zombies when they terminate */
@@ -2180,6 +2474,22 @@ setup(void)
 	/* clean up any zombies (inherited from .xinitrc etc) immediately */
 	while (waitpid(-1, NULL, WNOHANG) > 0);
 
+	/* SIGUSR1 reloads Xresources, SIGUSR2 dumps spawn latencies;
+	 * the handler only pokes run() */
+	if (pipe(sigpipe) == -1)
+		die("pipe:");
+	for (i = 0; i < 2; i++)
+		fcntl(sigpipe[i], F_SETFD, FD_CLOEXEC);
+	fcntl(sigpipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(sigpipe[1], F_SETFL, O_NONBLOCK);
+	sa.sa_flags = SA_RESTART;
+	sa.sa_handler = sigwake;
+	sigaction(SIGUSR1, &sa, NULL);
+	sigaction(SIGUSR2, &sa, NULL);
+
+	/* spawned children must not inherit the X connection */
+	fcntl(ConnectionNumber(dpy), F_SETFD, FD_CLOEXEC);
+
 	/* init screen */
 	screen = DefaultScreen(dpy);
 	sw = DisplayWidth(dpy, screen);
@@ -2190,20 +2500,20 @@ setup(void)
 		die("no fonts could be loaded.");
 	lrpad = drw->fonts->h;
 	bh = barheight ? barheight : drw->fonts->h + 2;
+	mainfontset = drw->fonts;
 	{
-		Fnt *mainfont = drw->fonts; /* save main font */
 		const char *statusfonts[] = { statusfont };
 		const char *tagsfonts[] = { tagsfont };
 
 		statusfontset = drw_fontset_create(drw, statusfonts, LENGTH(statusfonts));
 		if (!statusfontset)
-			statusfontset = mainfont; /* fallback to default fonts */
+			statusfontset = mainfontset; /* fallback to default fonts */
 
 		tagsfontset = drw_fontset_create(drw, tagsfonts, LENGTH(tagsfonts));
 		if (!tagsfontset)
-			tagsfontset = mainfont; /* fallback to default fonts */
+			tagsfontset = mainfontset; /* fallback to default fonts */
 
-		drw_setfontset(drw, mainfont); /* restore main font */
+		drw_setfontset(drw, mainfontset); /* restore main font */
 	}
 	updategeom();
 	/* init atoms */
@@ -2225,6 +2535,11 @@ setup(void)
 	netatom[NetWMWindowType] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE", False);
 	netatom[NetWMWindowTypeDialog] = XInternAtom(dpy, "_NET_WM_WINDOW_TYPE_DIALOG", False);
 	netatom[NetClientList] = XInternAtom(dpy, "_NET_CLIENT_LIST", False);
+	netatom[NetWMPid] = XInternAtom(dpy, "_NET_WM_PID", False);
+	statsatom = XInternAtom(dpy, "_DWM_CLIENT_STATS", False);
+#ifdef BENCH
+	benchatom = XInternAtom(dpy, "_DWM_BENCH", False);
+#endif /* BENCH */
 	xatom[Manager] = XInternAtom(dpy, "MANAGER", False);
 	xatom[Xembed] = XInternAtom(dpy, "_XEMBED", False);
 	xatom[XembedInfo] = XInternAtom(dpy, "_XEMBED_INFO", False);
@@ -2263,6 +2578,7 @@ setup(void)
 	XSelectInput(dpy, root, wa.event_mask);
 	grabkeys();
 	focus(NULL);
+	launchinit();
 }
 
 void
@@ -2284,7 +2600,10 @@ showhide(Client *c)
 	if (!c)
 		return;
 	if (ISVISIBLE(c)) {
-		/* show clients top down */
+		/* show clients top down, waking them up first */
+		c->hiddensince = 0;
+		if (c->frozen)
+			freeze(c->pid, 0);
 		XMoveWindow(dpy, c->win, c->x, c->y);
 		if ((!c->mon->lt[c->mon->sellt]->arrange || c->isfloating) && !c->isfullscreen)
 			resize(c, c->x, c->y, c->w, c->h, 0);
@@ -2293,53 +2612,182 @@ showhide(Client *c)
 		/* hide clients bottom up */
 		showhide(c->snext);
 		XMoveWindow(dpy, c->win, WIDTH(c) * -2, c->y);
+		if (c->freezehidden && c->pid && !c->hiddensince)
+			c->hiddensince = msec();
 	}
 }
 
 void
 spawn(const Arg *arg)
 {
-	struct sigaction sa;
+	SpawnStat *st = NULL;
+	PendingSpawn *ps;
+	const char *const *argv = arg->v;
+	size_t i, len;
+	pid_t pid;
 
 	if (arg->v == dmenucmd)
 		dmenumon[0] = '0' + selmon->num;
-	if (fork() == 0) {
-		if (dpy)
-			close(ConnectionNumber(dpy));
-		setsid();
+	if ((pid = spawnv(argv)) <= 0)
+		return;
+
+	/* remember when it was started so manage() can time it */
+	for (i = 0; i < LENGTH(spawnstats) && spawnstats[i].cmd && spawnstats[i].cmd != arg->v; i++);
+	if (i == LENGTH(spawnstats))
+		return;
+	st = &spawnstats[i];
+	if (!st->cmd) {
+		st->cmd = arg->v;
+		for (i = 0, len = 0; argv[i] && len < sizeof st->label - 1; i++)
+			len += snprintf(st->label + len, sizeof st->label - len, "%s%s",
+			                i ? " " : "", argv[i]);
+	}
+	/* reuse a free slot, or evict the oldest one */
+	for (ps = pendingspawns, i = 1; ps->pid && i < LENGTH(pendingspawns); i++)
+		if (!pendingspawns[i].pid
+		|| pendingspawns[i].start.tv_sec < ps->start.tv_sec)
+			ps = &pendingspawns[i];
+	ps->pid = pid;
+	ps->stat = st;
+	clock_gettime(CLOCK_MONOTONIC, &ps->start);
+}
 
-		sigemptyset(&sa.sa_mask);
-		sa.sa_flags = 0;
-		sa.sa_handler = SIG_DFL;
-		sigaction(SIGCHLD, &sa, NULL);
+/* posix_spawn without an intermediate shell; a leading "~/" in argv[0] is
+ * expanded to $HOME so scripts can be exec'd directly */
+pid_t
+spawnv(const char *const argv[])
+{
+	posix_spawnattr_t attr;
+	sigset_t defsigs;
+	char path[1024], **av;
+	const char *home;
+	size_t n;
+	pid_t pid;
+	short flags = POSIX_SPAWN_SETSIGDEF;
+	int err;
+
+	if (replaying)
+		return -1;
+	for (n = 0; argv[n]; n++);
+	av = ecalloc(n + 1, sizeof(char *));
+	memcpy(av, argv, n * sizeof(char *));
+	if (!strncmp(av[0], "~/", 2) && (home = getenv("HOME"))) {
+		snprintf(path, sizeof path, "%s/%s", home, av[0] + 2);
+		av[0] = path;
+	}
 
-		execvp(((char **)arg->v)[0], (char **)arg->v);
-		die("dwm: execvp '%s' failed:", ((char **)arg->v)[0]);
+	posix_spawnattr_init(&attr);
+	sigemptyset(&defsigs);
+	sigaddset(&defsigs, SIGCHLD);
+	posix_spawnattr_setsigdefault(&attr, &defsigs);
+#ifdef POSIX_SPAWN_SETSID
+	flags |= POSIX_SPAWN_SETSID;
+#else
+	flags |= POSIX_SPAWN_SETPGROUP;
+#endif /* POSIX_SPAWN_SETSID */
+#ifdef POSIX_SPAWN_USEVFORK
+	flags |= POSIX_SPAWN_USEVFORK;
+#endif /* POSIX_SPAWN_USEVFORK */
+	posix_spawnattr_setflags(&attr, flags);
+
+	if ((err = posix_spawnp(&pid, av[0], NULL, &attr, av, environ))) {
+		fprintf(stderr, "dwm: spawn '%s' failed: %s\n", av[0], strerror(err));
+		pid = -1;
 	}
+	posix_spawnattr_destroy(&attr);
+	free(av);
+	return pid;
 }
 
+/* account key-press-to-map time if c belongs to a pending spawn */
 void
-runAutostart(void)
+spawnlatency(Client *c)
 {
-	const char *const *p;
-	size_t i;
+	PendingSpawn *ps;
+	SpawnStat *st;
+	struct timespec now;
+	pid_t sid, pgid;
+	long ms;
+	size_t i, b;
+
+	if (!c->pid)
+		return;
+	/* children are session (or group) leaders, so grandchildren match too */
+	sid = getsid(c->pid);
+	pgid = getpgid(c->pid);
+	for (i = 0; i < LENGTH(pendingspawns); i++) {
+		ps = &pendingspawns[i];
+		if (!ps->pid || (ps->pid != c->pid && ps->pid != sid && ps->pid != pgid))
+			continue;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		ms = (now.tv_sec - ps->start.tv_sec) * 1000
+		   + (now.tv_nsec - ps->start.tv_nsec) / 1000000;
+		st = ps->stat;
+		st->min = st->n && st->min < ms ? st->min : ms;
+		st->max = MAX(st->max, ms);
+		st->sum += ms;
+		st->n++;
+		for (b = 0; b < SPAWNBUCKETS - 1 && ms >= 2L << b; b++);
+		st->hist[b]++;
+		ps->pid = 0;
+		return;
+	}
+}
+
+void
+spawnstatsdump(void)
+{
+	SpawnStat *st;
+	size_t i, j;
 
-	/* count entries */
-	for (i = 0; autostart[i]; i += 2)
-		;
+	fprintf(stderr, "dwm: key-press-to-map latency per command (ms)\n");
+	for (i = 0; i < LENGTH(spawnstats) && spawnstats[i].cmd; i++) {
+		st = &spawnstats[i];
+		if (!st->n)
+			continue;
+		fprintf(stderr, "  %-48s n=%u min=%ld avg=%ld max=%ld\n   ",
+		        st->label, st->n, st->min, st->sum / st->n, st->max);
+		for (j = 0; j < SPAWNBUCKETS; j++)
+			if (st->hist[j])
+				fprintf(stderr, " %s%ld:%u", j == SPAWNBUCKETS - 1 ? ">=" : "<",
+				        2L << (j == SPAWNBUCKETS - 1 ? j - 1 : j), st->hist[j]);
+		fputc('\n', stderr);
+	}
+}
 
-	/* launch them */
-	for (p = autostart; *p; p += 2) {
-		if (fork() == 0) {
-			setsid();
-			execvp(*p, (char *const *)p);
-			fprintf(stderr, "dwm: execvp %s\n", *p);
-			perror(" failed");
-			exit(EXIT_FAILURE);
-		}
+void
+spawnscratch(unsigned int i)
+{
+	spawn(&(Arg){ .v = scratchpads[i].cmd });
+	spstate[i].last = time(NULL);
+	spstate[i].pending = 1;
+}
+
+/* start every scratchpad hidden so the first toggle needs no spawn */
+void
+spawnscratchpads(void)
+{
+	Client *c = NULL;
+	Monitor *m;
+	unsigned int i;
+
+	for (i = 0; i < LENGTH(scratchpads); i++) {
+		for (c = NULL, m = mons; m && !c; m = m->next)
+			for (c = m->clients; c && !(c->tags & SPTAG(i)); c = c->next);
+		if (!c)
+			spawnscratch(i);
 	}
 }
 
+void
+runAutostart(void)
+{
+	const char *const *p;
+
+	for (p = autostart; *p; p += 2)
+		spawnv(p);
+}
+
 void
 tag(const Arg *arg)
 {
@@ -2372,6 +2820,42 @@ tagmon(const Arg *arg)
 	sendmon(selmon->sel, dirtomon(arg->i));
 }
 
+void
+togglescratch(const Arg *arg)
+{
+	Client *c = NULL;
+	Monitor *m, *oldmon = NULL;
+	unsigned int sptag = SPTAG(arg->ui);
+
+	for (m = mons; m && !c; m = m->next)
+		for (c = m->clients; c && !(c->tags & sptag); c = c->next);
+	if (!c) {
+		/* show it as soon as it maps */
+		selmon->tagset[selmon->seltags] |= sptag;
+		if (!spstate[arg->ui].pending || time(NULL) - spstate[arg->ui].last >= 5)
+			spawnscratch(arg->ui);
+		return;
+	}
+	if (c->mon != selmon) {
+		/* bring it to the focused monitor, keeping its size */
+		oldmon = c->mon;
+		oldmon->tagset[oldmon->seltags] &= ~sptag;
+		detach(c);
+		detachstack(c);
+		c->mon = selmon;
+		c->x = selmon->wx + (selmon->ww - WIDTH(c)) / 2;
+		c->y = selmon->wy + (selmon->wh - HEIGHT(c)) / 2;
+		attach(c);
+		attachstack(c);
+		selmon->tagset[selmon->seltags] |= sptag;
+	} else if (selmon->tagset[selmon->seltags] & ~sptag)
+		selmon->tagset[selmon->seltags] ^= sptag;
+	if (oldmon)
+		arrange(oldmon);
+	focus(ISVISIBLE(c) ? c : NULL);
+	arrange(selmon);
+}
+
 void
 togglebar(const Arg *arg)
 {
@@ -2462,6 +2946,8 @@ unfocus(Client *c, int setfocus)
 {
 	if (!c)
 		return;
+	if (boost.want == c->pid)
+		boost.want = 0;
 	grabbuttons(c, 0);
 	XSetWindowBorder(dpy, c->win, scheme[SchemeNorm][ColBorder].pixel);
 	if (setfocus) {
@@ -2473,11 +2959,16 @@ unfocus(Client *c, int setfocus)
 void
 unmanage(Client *c, int destroyed)
 {
-	Monitor *m = c->mon;
+	Monitor *m = c->mon, *t;
 	XWindowChanges wc;
+	unsigned int i;
 
 	detach(c);
 	detachstack(c);
+	if (mru.open)
+		switcherremove(c);
+	if (c->frozen)
+		freeze(c->pid, 0);
 	if (!destroyed) {
 		wc.border_width = c->oldbw;
 		XGrabServer(dpy); /* avoid race conditions */
@@ -2490,6 +2981,17 @@ unmanage(Client *c, int destroyed)
 		XSetErrorHandler(xerror);
 		XUngrabServer(dpy);
 	}
+	/* keep a dead scratchpad warm: hide its tag and respawn it in the
+	 * background, unless it keeps dying right after starting */
+	for (i = 0; running && i < LENGTH(scratchpads); i++) {
+		if (!(c->tags & SPTAG(i)))
+			continue;
+		for (t = mons; t; t = t->next)
+			if (t->tagset[t->seltags] & ~SPTAG(i))
+				t->tagset[t->seltags] &= ~SPTAG(i);
+		if (time(NULL) - spstate[i].last >= 2)
+			spawnscratch(i);
+	}
 	free(c);
 	focus(NULL);
 	updateclientlist();
@@ -3115,17 +3617,128 @@ load_xresources(void)
 	XrmDatabase db;
 	ResourcePref *p;
 
-	display = XOpenDisplay(NULL);
+	/* a fresh connection, RESOURCE_MANAGER is only read at connect time */
+	if (!(display = XOpenDisplay(NULL)))
+		return;
 	resm = XResourceManagerString(display);
-	if (!resm)
+	if (!resm) {
+		XCloseDisplay(display);
 		return;
+	}
 
 	db = XrmGetStringDatabase(resm);
 	for (p = resources; p < resources + LENGTH(resources); p++)
 		resource_load(db, p->name, p->type, p->dst);
+	XrmDestroyDatabase(db);
 	XCloseDisplay(display);
 }
 
+void
+sigwake(int sig)
+{
+	int saved_errno = errno;
+
+	if (sig == SIGUSR1)
+		reloadpending = 1;
+	else
+		statspending = 1;
+	write(sigpipe[1], "", 1);
+	errno = saved_errno;
+}
+
+/* swap in a fontset reloaded from name, keeping the old one on failure */
+static Fnt *
+reloadfontset(Fnt *old, const char *name, Fnt *fallback)
+{
+	const char *names[] = { name };
+	Fnt *cur = drw->fonts, *set;
+
+	set = drw_fontset_create(drw, names, LENGTH(names));
+	drw_setfontset(drw, cur);
+	if (!set)
+		return old;
+	if (old && old != fallback)
+		drw_fontset_free(old);
+	return set;
+}
+
+void
+xrdb(const Arg *arg)
+{
+	char oldclr[LENGTH(colors)][3][64];
+	char oldfont[256], oldstatusfont[256], oldtagsfont[256];
+	unsigned int oldborderpx = borderpx;
+	int oldbh = bh, i, j, changed;
+	Fnt *oldmain;
+	Client *c;
+	Monitor *m;
+	XWindowChanges wc;
+
+	for (i = 0; i < LENGTH(colors); i++)
+		for (j = 0; j < 3; j++)
+			snprintf(oldclr[i][j], sizeof oldclr[i][j], "%s", colors[i][j]);
+	memcpy(oldfont, font, sizeof oldfont);
+	memcpy(oldstatusfont, statusfont, sizeof oldstatusfont);
+	memcpy(oldtagsfont, tagsfont, sizeof oldtagsfont);
+
+	load_xresources();
+
+	/* only reallocate the schemes whose colors actually changed */
+	for (i = 0; i < LENGTH(colors); i++) {
+		for (j = 0, changed = 0; j < 3; j++)
+			changed |= strcmp(oldclr[i][j], colors[i][j]) != 0;
+		if (!changed)
+			continue;
+		drw_scm_free(drw, scheme[i], 3);
+		scheme[i] = drw_scm_create(drw, colors[i], 3);
+		if (i == 0) {
+			drw_scm_free(drw, scheme[LENGTH(colors)], 3);
+			scheme[LENGTH(colors)] = drw_scm_create(drw, colors[0], 3);
+		}
+	}
+
+	if (strcmp(oldfont, font)) {
+		oldmain = mainfontset;
+		mainfontset = reloadfontset(NULL, font, NULL);
+		if (mainfontset) {
+			if (statusfontset == oldmain)
+				statusfontset = mainfontset;
+			if (tagsfontset == oldmain)
+				tagsfontset = mainfontset;
+			drw_fontset_free(oldmain);
+		} else
+			mainfontset = oldmain;
+		drw_setfontset(drw, mainfontset);
+		lrpad = drw->fonts->h;
+		bh = barheight ? barheight : drw->fonts->h + 2;
+	}
+	if (strcmp(oldstatusfont, statusfont))
+		statusfontset = reloadfontset(statusfontset, statusfont, mainfontset);
+	if (strcmp(oldtagsfont, tagsfont))
+		tagsfontset = reloadfontset(tagsfontset, tagsfont, mainfontset);
+
+	for (m = mons; m; m = m->next) {
+		if (bh != oldbh) {
+			updatebarpos(m);
+			resizebarwin(m);
+		}
+		for (c = m->clients; c; c = c->next) {
+			if (borderpx != oldborderpx && !c->isfullscreen) {
+				c->bw = wc.border_width = borderpx;
+				XConfigureWindow(dpy, c->win, CWBorderWidth, &wc);
+			}
+			XSetWindowBorder(dpy, c->win,
+				scheme[c == selmon->sel ? SchemeSel : SchemeNorm][ColBorder].pixel);
+		}
+	}
+	if (bh != oldbh)
+		drw_resize(drw, sw, bh);
+	if (bh != oldbh || borderpx != oldborderpx)
+		arrange(NULL);
+	updatesystray();
+	drawbars();
+}
+
 Monitor *
 systraytomon(Monitor *m) {
 	Monitor *t;
@@ -3142,27 +3755,1594 @@ systraytomon(Monitor *m) {
 	return t;
 }
 
-int
-main(int argc, char *argv[])
+/* built-in launcher
+ *
+ * Executables in $PATH and .desktop entries are indexed once at startup and
+ * kept in memory. Each directory is watched with inotify and rescanned on its
+ * own, debounced, when it changes, so opening the prompt never touches the
+ * file system unless something changed since the last rescan. */
+static void
+launchfreedir(LaunchDir *d)
 {
-	if (argc == 2 && !strcmp("-v", argv[1]))
-		die("dwm-"VERSION);
-	else if (argc != 1)
-		die("usage: dwm [-v]");
-	if (!setlocale(LC_CTYPE, "") || !XSupportsLocale())
-		fputs("warning: no locale support\n", stderr);
-	if (!(dpy = XOpenDisplay(NULL)))
-		die("dwm: cannot open display");
-	checkotherwm();
-	XrmInitialize();
-	load_xresources();
-	setup();
+	size_t i;
+
+	for (i = 0; i < d->n; i++) {
+		free(d->items[i].name);
+		free(d->items[i].exec);
+	}
+	free(d->items);
+	d->items = NULL;
+	d->n = d->cap = 0;
+}
+
+static void
+launchadd(LaunchDir *d, const char *name, const char *exec)
+{
+	if (d->n == d->cap) {
+		d->cap = d->cap ? d->cap * 2 : 64;
+		if (!(d->items = realloc(d->items, d->cap * sizeof(LaunchItem))))
+			die("realloc:");
+	}
+	if (!(d->items[d->n].name = strdup(name))
+	|| (exec && !(d->items[d->n].exec = strdup(exec))))
+		die("strdup:");
+	if (!exec)
+		d->items[d->n].exec = NULL;
+	d->n++;
+}
+
+/* parse the [Desktop Entry] group of a .desktop file, dropping Exec field codes */
+static void
+launchdesktop(LaunchDir *d, int dirfd, const char *file)
+{
+	char line[1024], name[256] = "", exec[1024] = "", *p, *q;
+	int fd, group = 0, hidden = 0, terminal = 0, app = 1;
+	size_t i, len;
+	FILE *fp;
+
+	if ((fd = openat(dirfd, file, O_RDONLY|O_CLOEXEC)) == -1)
+		return;
+	if (!(fp = fdopen(fd, "r"))) {
+		close(fd);
+		return;
+	}
+	while (fgets(line, sizeof line, fp)) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if (line[0] == '[') {
+			group = !strcmp(line, "[Desktop Entry]");
+			continue;
+		}
+		if (!group)
+			continue;
+		if (!strncmp(line, "Name=", 5))
+			snprintf(name, sizeof name, "%.255s", line + 5);
+		else if (!strncmp(line, "Exec=", 5))
+			snprintf(exec, sizeof exec, "%s", line + 5);
+		else if (!strcmp(line, "NoDisplay=true") || !strcmp(line, "Hidden=true"))
+			hidden = 1;
+		else if (!strcmp(line, "Terminal=true"))
+			terminal = 1;
+		else if (!strncmp(line, "Type=", 5))
+			app = !strcmp(line + 5, "Application");
+	}
+	fclose(fp);
+	if (hidden || !app || !name[0] || !exec[0])
+		return;
+	for (p = q = exec; *p; p++) {
+		if (*p != '%')
+			*q++ = *p;
+		else if (p[1] == '%')
+			*q++ = *++p;
+		else if (p[1])
+			p++;
+	}
+	*q = '\0';
+	if (terminal) {
+		memmove(line, exec, strlen(exec) + 1);
+		for (i = 0, len = 0; launcherterm[i]; i++)
+			len += snprintf(exec + len, sizeof exec - len, "%s ", launcherterm[i]);
+		snprintf(exec + len, sizeof exec - len, "%s", line);
+	}
+	launchadd(d, name, exec);
+}
+
+static void
+launchscan(LaunchDir *d)
+{
+	struct dirent *e;
+	struct stat st;
+	size_t len;
+	DIR *dp;
+
+	launchfreedir(d);
+	d->dirty = 0;
+	if (!(dp = opendir(d->path)))
+		return;
+	if (!fstat(dirfd(dp), &st))
+		d->mtime = st.st_mtime;
+	while ((e = readdir(dp))) {
+		if (e->d_name[0] == '.')
+			continue;
+		if (d->desktop) {
+			len = strlen(e->d_name);
+			if (len > 8 && !strcmp(e->d_name + len - 8, ".desktop"))
+				launchdesktop(d, dirfd(dp), e->d_name);
+		} else if (!fstatat(dirfd(dp), e->d_name, &st, 0) && S_ISREG(st.st_mode)
+		&& !faccessat(dirfd(dp), e->d_name, X_OK, 0))
+			launchadd(d, e->d_name, NULL);
+	}
+	closedir(dp);
+}
+
+static void
+launchdiradd(const char *path, int desktop)
+{
+	size_t i;
+
+	if (!path || path[0] != '/')
+		return;
+	for (i = 0; i < nlaunchdirs; i++)
+		if (!strcmp(launchdirs[i].path, path))
+			return;
+	if (!(launchdirs = realloc(launchdirs, (nlaunchdirs + 1) * sizeof(LaunchDir))))
+		die("realloc:");
+	memset(&launchdirs[nlaunchdirs], 0, sizeof(LaunchDir));
+	if (!(launchdirs[nlaunchdirs].path = strdup(path)))
+		die("strdup:");
+	launchdirs[nlaunchdirs].desktop = desktop;
+	launchdirs[nlaunchdirs].wd = -1;
+	launchdirs[nlaunchdirs].dirty = 1;
+	nlaunchdirs++;
+}
+
+void
+launchinit(void)
+{
+	XSetWindowAttributes wa = {
+		.override_redirect = True,
+		.background_pixmap = ParentRelative,
+		.event_mask = ExposureMask
+	};
+	XClassHint ch = { "dwm", "dwm" };
+	char buf[1024], *path, *p, *home = getenv("HOME"), *data = getenv("XDG_DATA_HOME");
+	size_t i;
+
+	if ((path = getenv("PATH"))) {
+		snprintf(buf, sizeof buf, "%s", path);
+		for (p = strtok(buf, ":"); p; p = strtok(NULL, ":"))
+			launchdiradd(p, 0);
+	}
+	if (data)
+		snprintf(buf, sizeof buf, "%s/applications", data);
+	else
+		snprintf(buf, sizeof buf, "%s/.local/share/applications", home ? home : "");
+	launchdiradd(buf, 1);
+	launchdiradd("/usr/local/share/applications", 1);
+	launchdiradd("/usr/share/applications", 1);
+
+#ifdef __linux__
+	if ((inotifyfd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC)) != -1)
+		for (i = 0; i < nlaunchdirs; i++)
+			launchdirs[i].wd = inotify_add_watch(inotifyfd, launchdirs[i].path,
+				IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO|IN_ATTRIB|IN_CLOSE_WRITE|IN_ONLYDIR);
+#endif /* __linux__ */
+	for (i = 0; i < nlaunchdirs; i++)
+		launchscan(&launchdirs[i]);
+
+	overlaywin = XCreateWindow(dpy, root, 0, 0, 1, 1, 0, DefaultDepth(dpy, screen),
+		CopyFromParent, DefaultVisual(dpy, screen),
+		CWOverrideRedirect|CWBackPixmap|CWEventMask, &wa);
+	XSetClassHint(dpy, overlaywin, &ch);
+}
+
+void
+launchcleanup(void)
+{
+	size_t i;
+
+	for (i = 0; i < nlaunchdirs; i++) {
+		launchfreedir(&launchdirs[i]);
+		free(launchdirs[i].path);
+	}
+	free(launchdirs);
+	free(launch.match);
+	if (inotifyfd != -1)
+		close(inotifyfd);
+	XDestroyWindow(dpy, overlaywin);
+}
+
+/* drain the inotify queue and mark the affected directories; the actual
+ * rescan is left to launchrescan() once the directories settle down */
+void
+launchwatch(void)
+{
+#ifdef __linux__
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *ie;
+	ssize_t len;
+	char *p;
+	size_t i;
+
+	while ((len = read(inotifyfd, buf, sizeof buf)) > 0)
+		for (p = buf; p < buf + len; p += sizeof(struct inotify_event) + ie->len) {
+			ie = (const struct inotify_event *)p;
+			for (i = 0; i < nlaunchdirs; i++)
+				if (launchdirs[i].wd == ie->wd) {
+					if (ie->mask & IN_IGNORED)
+						launchdirs[i].wd = -1;
+					launchdirs[i].dirty = 1;
+					launchpending = 1;
+				}
+		}
+#endif /* __linux__ */
+}
+
+void
+launchrescan(void)
+{
+	struct stat st;
+	size_t i;
+
+	for (i = 0; i < nlaunchdirs; i++) {
+		/* without a watch fall back to the directory mtime */
+		if (launchdirs[i].wd == -1 && !stat(launchdirs[i].path, &st)
+		&& st.st_mtime != launchdirs[i].mtime)
+			launchdirs[i].dirty = 1;
+		if (launchdirs[i].dirty)
+			launchscan(&launchdirs[i]);
+	}
+	launchpending = 0;
+}
+
+/* case-insensitive subsequence match; consecutive characters, word starts
+ * and short names score higher */
+static int
+fuzzymatch(const char *pat, const char *s, int *ret)
+{
+	const char *p = pat, *q;
+	int score = 0, run = 0, first = 0;
+
+	for (q = s; *p && *q; q++) {
+		if (tolower((unsigned char)*q) != tolower((unsigned char)*p)) {
+			run = 0;
+			continue;
+		}
+		if (p == pat)
+			first = q - s;
+		score += 1 + 4 * run++;
+		if (q == s || strchr(" -_./", q[-1]))
+			score += 8;
+		p++;
+	}
+	if (*p)
+		return 0;
+	*ret = score * 64 - first * 4 - (int)strlen(s);
+	return 1;
+}
+
+static int
+cmpmatch(const void *a, const void *b)
+{
+	const LaunchMatch *x = a, *y = b;
+	int r;
+
+	if (x->score != y->score)
+		return y->score - x->score;
+	if ((r = strcmp(x->item->name, y->item->name)))
+		return r;
+	return x->dir - y->dir;
+}
+
+static void
+launchfilter(void)
+{
+	size_t i, j, n = 0;
+	int score;
+
+	for (i = 0; i < nlaunchdirs; i++)
+		n += launchdirs[i].n;
+	if (n > launch.cap) {
+		launch.cap = n;
+		if (!(launch.match = realloc(launch.match, n * sizeof(LaunchMatch))))
+			die("realloc:");
+	}
+	launch.nmatch = 0;
+	for (i = 0; i < nlaunchdirs; i++)
+		for (j = 0; j < launchdirs[i].n; j++)
+			if (fuzzymatch(launch.text, launchdirs[i].items[j].name, &score)) {
+				launch.match[launch.nmatch].item = &launchdirs[i].items[j];
+				launch.match[launch.nmatch].dir = i;
+				launch.match[launch.nmatch++].score = score;
+			}
+	/* equal names sort in directory order: keep the first, like $PATH lookup does */
+	qsort(launch.match, launch.nmatch, sizeof(LaunchMatch), cmpmatch);
+	for (i = j = 0; i < launch.nmatch; i++)
+		if (!j || strcmp(launch.match[j - 1].item->name, launch.match[i].item->name)
+		|| !launch.match[j - 1].item->exec != !launch.match[i].item->exec)
+			launch.match[j++] = launch.match[i];
+	launch.nmatch = j;
+	launch.sel = 0;
+}
+
+/* map the overlay window centred in the upper part of m; the drw pixmap
+ * is grown to fit and left that size, the bars only use its first rows */
+static void
+overlayshow(Monitor *m, unsigned int w, unsigned int h)
+{
+	overlayw = w;
+	overlayh = h;
+	if (drw->w < w || drw->h < h)
+		drw_resize(drw, MAX(drw->w, w), MAX(drw->h, h));
+	XMoveResizeWindow(dpy, overlaywin, m->wx + (m->ww - w) / 2, m->wy + m->wh / 6, w, h);
+	XMapRaised(dpy, overlaywin);
+}
+
+void
+launchdraw(void)
+{
+	char prompt[sizeof launch.text + 8];
+	unsigned int w = overlayw, h = overlayh, i, first;
+	Fnt *oldfont = drw->fonts;
+
+	drw_setfontset(drw, mainfontset);
+
+	drw_setscheme(drw, scheme[SchemeNorm]);
+	drw_rect(drw, 0, 0, w, h, 1, 1);
+	snprintf(prompt, sizeof prompt, "> %s_", launch.text);
+	drw_setscheme(drw, scheme[SchemeSel]);
+	drw_text(drw, 0, 0, w, bh, lrpad / 2, prompt, 0);
+	first = launch.sel - launch.sel % launcherlines;
+	for (i = 0; i < launcherlines && first + i < launch.nmatch; i++) {
+		drw_setscheme(drw, scheme[first + i == launch.sel ? SchemeSel : SchemeNorm]);
+		drw_text(drw, 0, bh * (i + 1), w, bh, lrpad / 2, launch.match[first + i].item->name, 0);
+	}
+	drw_map(drw, overlaywin, 0, 0, w, h);
+	drw_setfontset(drw, oldfont);
+}
+
+void
+launcher(const Arg *arg)
+{
+	if (launch.open || mru.open)
+		return;
+	if (XGrabKeyboard(dpy, root, False, GrabModeAsync, GrabModeAsync, CurrentTime) != GrabSuccess)
+		return;
+	if (launchpending || inotifyfd == -1)
+		launchrescan();
+	launch.open = 1;
+	launch.text[0] = '\0';
+	launch.len = 0;
+	launchfilter();
+	overlayshow(selmon, MIN(selmon->ww, MAX(selmon->ww / 2, 400)), bh * (launcherlines + 1));
+	launchdraw();
+}
+
+static void
+launchclose(void)
+{
+	launch.open = 0;
+	XUngrabKeyboard(dpy, CurrentTime);
+	XUnmapWindow(dpy, overlaywin);
+}
+
+static void
+launchrun(int raw)
+{
+	const char *argv[] = { "/bin/sh", "-c", NULL, NULL };
+	LaunchItem *it = launch.nmatch && !raw ? launch.match[launch.sel].item : NULL;
+
+	if (!it && !launch.len)
+		return;
+	if (it && !it->exec)
+		argv[0] = it->name, argv[1] = NULL;
+	else
+		argv[2] = it ? it->exec : launch.text;
+	spawnv(argv);
+}
+
+/* keyboard is grabbed while the prompt is open, all key presses end up here */
+void
+launchkey(XKeyEvent *ev)
+{
+	char buf[32];
+	KeySym ksym = NoSymbol;
+	int n;
+
+	n = XLookupString(ev, buf, sizeof buf, &ksym, NULL);
+	if (ev->state & ControlMask) {
+		switch (ksym) {
+		case XK_bracketleft: ksym = XK_Escape; break;
+		case XK_j: case XK_m: ksym = XK_Return; break;
+		case XK_h: ksym = XK_BackSpace; break;
+		case XK_n: ksym = XK_Down; break;
+		case XK_p: ksym = XK_Up; break;
+		case XK_u:
+			launch.text[launch.len = 0] = '\0';
+			launchfilter();
+			launchdraw();
+			return;
+		default:
+			return;
+		}
+	}
+	switch (ksym) {
+	case XK_Escape:
+		launchclose();
+		return;
+	case XK_Return:
+	case XK_KP_Enter:
+		launchrun(ev->state & ShiftMask);
+		launchclose();
+		return;
+	case XK_BackSpace:
+		if (!launch.len)
+			return;
+		/* drop a whole UTF-8 sequence */
+		while (launch.len && (launch.text[--launch.len] & 0xc0) == 0x80);
+		launch.text[launch.len] = '\0';
+		launchfilter();
+		break;
+	case XK_Down:
+	case XK_Tab:
+		if (launch.sel + 1 < launch.nmatch)
+			launch.sel++;
+		break;
+	case XK_Up:
+	case XK_ISO_Left_Tab:
+		if (launch.sel)
+			launch.sel--;
+		break;
+	case XK_Next:
+		launch.sel = MIN(launch.sel + launcherlines, launch.nmatch ? launch.nmatch - 1 : 0);
+		break;
+	case XK_Prior:
+		launch.sel = launch.sel > launcherlines ? launch.sel - launcherlines : 0;
+		break;
+	default:
+		if (n <= 0 || (unsigned char)buf[0] < 0x20 || buf[0] == 0x7f
+		|| launch.len + n >= sizeof launch.text)
+			return;
+		memcpy(launch.text + launch.len, buf, n);
+		launch.text[launch.len += n] = '\0';
+		launchfilter();
+		break;
+	}
+	launchdraw();
+}
+
+/* MRU window switcher
+ *
+ * Lists every client on every monitor and tag, most recently focused first,
+ * and walks that list while the modifier of the binding is held. Releasing
+ * the modifier focuses the selected client, switching monitor and tag as
+ * needed. */
+static int
+cmpfocusseq(const void *a, const void *b)
+{
+	const Client *x = *(Client *const *)a, *y = *(Client *const *)b;
+
+	return (x->focusseq < y->focusseq) - (x->focusseq > y->focusseq);
+}
+
+/* does keycode kc carry the switcher's modifier */
+static int
+ismodkey(KeyCode kc)
+{
+	XModifierKeymap *mm = mru.modmap;
+	int i, j;
+
+	for (i = 0; i < 8; i++)
+		if (mru.mod & (1 << i))
+			for (j = 0; j < mm->max_keypermod; j++)
+				if (kc && mm->modifiermap[i * mm->max_keypermod + j] == kc)
+					return 1;
+	return 0;
+}
+
+/* is any key of the switcher's modifier still held down */
+static int
+modheld(void)
+{
+	char keys[32];
+	int kc;
+
+	XQueryKeymap(dpy, keys);
+	for (kc = 0; kc < 256; kc++)
+		if (keys[kc / 8] & (1 << kc % 8) && ismodkey(kc))
+			return 1;
+	return 0;
+}
+
+void
+switcherdraw(void)
+{
+	char label[sizeof ((Client *)0)->name + 64];
+	unsigned int i, t, first, lines = overlayh / bh;
+	Fnt *oldfont = drw->fonts;
+	Client *c;
+
+	drw_setfontset(drw, mainfontset);
+	drw_setscheme(drw, scheme[SchemeNorm]);
+	drw_rect(drw, 0, 0, overlayw, overlayh, 1, 1);
+	first = mru.sel - mru.sel % lines;
+	for (i = 0; i < lines && first + i < mru.n; i++) {
+		c = mru.list[first + i];
+		for (t = 0; t < LENGTH(tags) && !(c->tags & 1 << t); t++);
+		if (mons->next)
+			snprintf(label, sizeof label, "%d:%s  %s", c->mon->num,
+			         t < LENGTH(tags) ? tags[t] : "*", c->name);
+		else
+			snprintf(label, sizeof label, "%s  %s", t < LENGTH(tags) ? tags[t] : "*", c->name);
+		drw_setscheme(drw, scheme[first + i == mru.sel ? SchemeSel : SchemeNorm]);
+		drw_text(drw, 0, bh * i, overlayw, bh, lrpad / 2, label, 0);
+	}
+	drw_map(drw, overlaywin, 0, 0, overlayw, overlayh);
+	drw_setfontset(drw, oldfont);
+}
+
+static void
+switcherclose(void)
+{
+	mru.open = 0;
+	XFreeModifiermap(mru.modmap);
+	XUngrabKeyboard(dpy, CurrentTime);
+	XUnmapWindow(dpy, overlaywin);
+}
+
+static void
+switchercommit(void)
+{
+	Client *c = mru.n ? mru.list[mru.sel] : NULL;
+	unsigned int t;
+
+	switcherclose();
+	if (!c)
+		return;
+	if (c->mon != selmon) {
+		unfocus(selmon->sel, 0);
+		selmon = c->mon;
+	}
+	if (!ISVISIBLE(c)) {
+		if ((t = c->tags & ~SPTAGMASK)) {
+			view(&(Arg){ .ui = t & -t });
+		} else {
+			/* hidden scratchpad: show it next to the current view */
+			selmon->tagset[selmon->seltags] |= c->tags;
+			arrange(selmon);
+		}
+	}
+	focus(c);
+}
+
+void
+switcherremove(Client *c)
+{
+	size_t i;
+
+	for (i = 0; i < mru.n && mru.list[i] != c; i++);
+	if (i == mru.n)
+		return;
+	memmove(&mru.list[i], &mru.list[i + 1], (mru.n - i - 1) * sizeof(Client *));
+	if (!--mru.n) {
+		switcherclose();
+		return;
+	}
+	if (mru.sel > i || mru.sel == mru.n)
+		mru.sel--;
+	switcherdraw();
+}
+
+void
+switcher(const Arg *arg)
+{
+	unsigned int lines;
+	Monitor *m;
+	Client *c;
+	size_t n = 0;
+
+	if (launch.open || mru.open)
+		return;
+	for (m = mons; m; m = m->next)
+		for (c = m->clients; c; c = c->next, n++);
+	if (n < 2)
+		return;
+	if (XGrabKeyboard(dpy, root, False, GrabModeAsync, GrabModeAsync, CurrentTime) != GrabSuccess)
+		return;
+	if (n > mru.cap) {
+		mru.cap = n + 16;
+		if (!(mru.list = realloc(mru.list, mru.cap * sizeof(Client *))))
+			die("realloc:");
+	}
+	for (mru.n = 0, m = mons; m; m = m->next)
+		for (c = m->clients; c; c = c->next)
+			mru.list[mru.n++] = c;
+	qsort(mru.list, mru.n, sizeof(Client *), cmpfocusseq);
+	mru.sel = arg->i < 0 ? mru.n - 1 : 1;
+	/* the binding's modifier, Shift only reverses the direction */
+	for (mru.mod = 0, n = 0; n < LENGTH(keys); n++)
+		if (keys[n].func == switcher && keys[n].arg.i == arg->i)
+			mru.mod = CLEANMASK(keys[n].mod) & ~ShiftMask;
+	mru.modmap = XGetModifierMapping(dpy);
+	mru.open = 1;
+	/* a quick tap is over before we could see the release */
+	if (!mru.mod || !modheld()) {
+		switchercommit();
+		return;
+	}
+	lines = MIN(switcherlines, mru.n);
+	overlayshow(selmon, MIN(selmon->ww, MAX(selmon->ww / 2, 400)), bh * lines);
+	switcherdraw();
+}
+
+void
+switcherkey(XKeyEvent *ev)
+{
+	KeySym ksym = XKeycodeToKeysym(dpy, (KeyCode)ev->keycode, 0);
+
+	switch (ksym) {
+	case XK_Escape:
+		switcherclose();
+		return;
+	case XK_Return:
+	case XK_KP_Enter:
+		switchercommit();
+		return;
+	case XK_Tab:
+		if (ev->state & ShiftMask)
+			mru.sel = mru.sel ? mru.sel - 1 : mru.n - 1;
+		else
+			mru.sel = (mru.sel + 1) % mru.n;
+		break;
+	case XK_ISO_Left_Tab:
+	case XK_Up:
+		mru.sel = mru.sel ? mru.sel - 1 : mru.n - 1;
+		break;
+	case XK_Down:
+		mru.sel = (mru.sel + 1) % mru.n;
+		break;
+	default:
+		return;
+	}
+	switcherdraw();
+}
+
+void
+switcherrelease(XKeyEvent *ev)
+{
+	/* with several keys for the modifier, wait for the last one */
+	if (ismodkey(ev->keycode) && !modheld())
+		switchercommit();
+}
+
+long
+msec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000L + ts.tv_nsec / 1000000;
+}
+
+/* pid followed by all of its descendants, found through /proc on Linux;
+ * the caller frees the array */
+static pid_t *
+proctree(pid_t pid, size_t *ntree)
+{
+	pid_t *pids = NULL, *ppids = NULL, *tree;
+	size_t n = 0, cap = 0, i, j;
+#ifdef __linux__
+	char path[sizeof ((struct dirent *)0)->d_name + 16], buf[512], *p;
+	struct dirent *e;
+	DIR *dp;
+	FILE *fp;
+	int ppid;
+
+	if ((dp = opendir("/proc"))) {
+		while ((e = readdir(dp))) {
+			if (!isdigit((unsigned char)e->d_name[0]))
+				continue;
+			snprintf(path, sizeof path, "/proc/%s/stat", e->d_name);
+			if (!(fp = fopen(path, "r")))
+				continue;
+			/* pid (comm) state ppid ..., comm may contain anything */
+			if (fgets(buf, sizeof buf, fp) && (p = strrchr(buf, ')'))
+			&& sscanf(p + 1, " %*c %d", &ppid) == 1) {
+				if (n == cap) {
+					cap = cap ? cap * 2 : 512;
+					if (!(pids = realloc(pids, cap * sizeof(pid_t)))
+					|| !(ppids = realloc(ppids, cap * sizeof(pid_t))))
+						die("realloc:");
+				}
+				pids[n] = atoi(e->d_name);
+				ppids[n++] = ppid;
+			}
+			fclose(fp);
+		}
+		closedir(dp);
+	}
+#endif /* __linux__ */
+	tree = ecalloc(n + 1, sizeof(pid_t));
+	tree[0] = pid;
+	*ntree = 1;
+	for (i = 0; i < *ntree; i++)
+		for (j = 0; j < n; j++)
+			if (ppids[j] == tree[i] && pids[j] != tree[i])
+				tree[(*ntree)++] = pids[j];
+	free(pids);
+	free(ppids);
+	return tree;
+}
+
+/* Electron and browser windows belong to a tree of renderer and helper
+ * processes, signal all of them */
+static void
+signaltree(pid_t pid, int sig)
+{
+	pid_t *tree;
+	size_t n, i;
+
+	tree = proctree(pid, &n);
+	for (i = 0; i < n; i++)
+		kill(tree[i], sig);
+	free(tree);
+}
+
+/* stop or continue the processes behind pid; all clients of that process
+ * share the state */
+void
+freeze(pid_t pid, int stop)
+{
+	Monitor *m;
+	Client *c;
+
+	if (pid <= 1 || pid == getpid())
+		return;
+	signaltree(pid, stop ? SIGSTOP : SIGCONT);
+	for (m = mons; m; m = m->next)
+		for (c = m->clients; c; c = c->next)
+			if (c->pid == pid)
+				c->frozen = stop;
+	drawbars();
+}
+
+/* freeze clients whose grace period ran out, unless a window of the same
+ * process is still shown; returns msec until the next deadline or -1 */
+long
+freezecheck(void)
+{
+	Monitor *m, *m2;
+	Client *c, *c2;
+	long now = 0, left, next = -1;
+	int shown;
+
+	for (m = mons; m; m = m->next)
+		for (c = m->clients; c; c = c->next) {
+			if (!c->hiddensince || c->frozen)
+				continue;
+			if (!now)
+				now = msec();
+			if ((left = c->hiddensince + freezegrace * 1000L - now) > 0) {
+				next = next < 0 ? left : MIN(next, left);
+				continue;
+			}
+			for (shown = 0, m2 = mons; m2 && !shown; m2 = m2->next)
+				for (c2 = m2->clients; c2 && !shown; c2 = c2->next)
+					shown = c2->pid == c->pid && ISVISIBLE(c2);
+			if (shown)
+				c->hiddensince = 0; /* restarts when that one is hidden */
+			else
+				freeze(c->pid, 1);
+		}
+	return next;
+}
+
+/* write s to path, for cgroup files */
+static int
+writestr(const char *path, const char *s)
+{
+	int fd, r;
+
+	if ((fd = open(path, O_WRONLY|O_CLOEXEC)) == -1)
+		return -1;
+	r = write(fd, s, strlen(s)) == (ssize_t)strlen(s) ? 0 : -1;
+	close(fd);
+	return r;
+}
+
+/* threads of pid, nice values and I/O priorities are per thread on Linux;
+ * the caller frees the array */
+static pid_t *
+proctasks(pid_t pid, size_t *ntask)
+{
+	pid_t *tasks = NULL;
+#ifdef __linux__
+	char path[32];
+	struct dirent *e;
+	size_t cap = 0;
+	DIR *dp;
+
+	*ntask = 0;
+	snprintf(path, sizeof path, "/proc/%d/task", (int)pid);
+	if ((dp = opendir(path))) {
+		while ((e = readdir(dp))) {
+			if (!isdigit((unsigned char)e->d_name[0]))
+				continue;
+			if (*ntask == cap) {
+				cap = cap ? cap * 2 : 16;
+				if (!(tasks = realloc(tasks, cap * sizeof(pid_t))))
+					die("realloc:");
+			}
+			tasks[(*ntask)++] = atoi(e->d_name);
+		}
+		closedir(dp);
+	}
+	if (*ntask)
+		return tasks;
+	free(tasks);
+#endif /* __linux__ */
+	tasks = ecalloc(1, sizeof(pid_t));
+	tasks[0] = pid;
+	*ntask = 1;
+	return tasks;
+}
+
+/* the cgroup v2 of pid if it is delegated to us and holds nothing but
+ * processes of tree, so that raising its weight boosts no one else */
+static int
+boostcgroup(pid_t pid, pid_t *tree, size_t n)
+{
+#ifdef __linux__
+	char path[64], line[sizeof boost.cgroup + 32], *p;
+	size_t i;
+	FILE *fp;
+	int found = 0, other = 0, q;
+
+	snprintf(path, sizeof path, "/proc/%d/cgroup", pid);
+	if (!(fp = fopen(path, "r")))
+		return 0;
+	while (!found && fgets(line, sizeof line, fp))
+		if (!strncmp(line, "0::/", 4)) {
+			line[strcspn(line, "\n")] = '\0';
+			found = snprintf(boost.cgroup, sizeof boost.cgroup, "/sys/fs/cgroup%s", line + 3)
+			        < (int)sizeof boost.cgroup - 16;
+		}
+	fclose(fp);
+	if (!found || access(boost.cgroup, W_OK))
+		return boost.cgroup[0] = '\0';
+
+	snprintf(line, sizeof line, "%s/cgroup.procs", boost.cgroup);
+	if (!(fp = fopen(line, "r")))
+		return boost.cgroup[0] = '\0';
+	while (!other && fscanf(fp, "%d", &q) == 1) {
+		for (i = 0; i < n && tree[i] != q; i++);
+		other = i == n;
+	}
+	fclose(fp);
+	strcat(boost.cgroup, "/cpu.weight");
+	if (other || !(fp = fopen(boost.cgroup, "r")))
+		return boost.cgroup[0] = '\0';
+	p = fgets(boost.weight, sizeof boost.weight, fp);
+	fclose(fp);
+	snprintf(line, sizeof line, "%u\n", focuscpuweight);
+	if (!p || writestr(boost.cgroup, line))
+		return boost.cgroup[0] = '\0';
+	return 1;
+#else
+	return 0;
+#endif /* __linux__ */
+}
+
+/* Move the focus boost to the focused client's process: lower nice value,
+ * best-effort I/O priority and cgroup cpu.weight. Only the part of the
+ * process tree in the client's session is boosted, so jobs started from a
+ * focused terminal are not. Runs from the idle point of run(), not from
+ * focus(), because walking /proc is too slow for the event path. */
+void
+boostsync(void)
+{
+	static int nicedenied;
+	pid_t *tree, *task, sid;
+	size_t n, nt, cap, i, j, k;
+	BoostProc *bp;
+
+	if (boost.pid) {
+		/* restore, processes forked since inherited the boost too */
+		tree = proctree(boost.pid, &n);
+		for (i = 0; i < n && boost.n; i++) {
+			if (i && getsid(tree[i]) != boost.sid)
+				continue;
+			task = proctasks(tree[i], &nt);
+			for (k = 0; k < nt; k++) {
+				/* threads started since get their process' values */
+				for (j = 0; j < boost.n && boost.procs[j].pid != task[k]; j++);
+				if (j == boost.n)
+					for (j = 0; j < boost.n && boost.procs[j].pid != tree[i]; j++);
+				bp = j < boost.n ? &boost.procs[j] : &boost.procs[0];
+				if (focusnice && !nicedenied)
+					setpriority(PRIO_PROCESS, task[k], bp->nice);
+#ifdef __linux__
+				if (focusioprio >= 0)
+					syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, task[k], bp->ioprio);
+#endif /* __linux__ */
+			}
+			free(task);
+		}
+		free(tree);
+		if (boost.cgroup[0])
+			writestr(boost.cgroup, boost.weight);
+		boost.cgroup[0] = '\0';
+		boost.n = 0;
+		boost.pid = 0;
+	}
+	if (boost.want <= 1 || boost.want == getpid() || (sid = getsid(boost.want)) == -1)
+		return;
+
+	boost.pid = boost.want;
+	boost.sid = sid;
+	tree = proctree(boost.pid, &n);
+	free(boost.procs);
+	boost.procs = NULL;
+	cap = 0;
+	for (i = 0; i < n; i++) {
+		if (i && getsid(tree[i]) != sid)
+			continue;
+		task = proctasks(tree[i], &nt);
+		for (k = 0; k < nt; k++) {
+			if (boost.n == cap) {
+				cap = cap ? cap * 2 : 64;
+				if (!(boost.procs = realloc(boost.procs, cap * sizeof(BoostProc))))
+					die("realloc:");
+			}
+			bp = &boost.procs[boost.n];
+			bp->pid = task[k];
+			errno = 0;
+			bp->nice = getpriority(PRIO_PROCESS, task[k]);
+			if (errno)
+				continue;
+#ifdef __linux__
+			bp->ioprio = syscall(SYS_ioprio_get, IOPRIO_WHO_PROCESS, task[k]);
+			if (focusioprio >= 0 && bp->ioprio >= 0)
+				syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, task[k],
+				        IOPRIO_PRIO_VALUE(IOPRIO_CLASS_BE, focusioprio));
+#endif /* __linux__ */
+			boost.n++;
+			if (!focusnice || nicedenied
+			|| setpriority(PRIO_PROCESS, task[k], MAX(bp->nice - focusnice, -20)) == 0)
+				continue;
+			if (errno == EPERM || errno == EACCES) {
+				/* raising priority needs CAP_SYS_NICE or RLIMIT_NICE */
+				fputs("dwm: focus boost: cannot lower nice values, disabled\n", stderr);
+				nicedenied = 1;
+			}
+		}
+		free(task);
+	}
+	if (focuscpuweight && boost.n)
+		boostcgroup(boost.pid, tree, n);
+	free(tree);
+}
+
+/* per client resource usage
+ *
+ * Every clientstatsinterval msec the /proc listing is diffed against the
+ * table of known processes. Only processes that are new or belong to a
+ * client's process tree are read, a few per call, and run() goes back to
+ * the X queue in between. The sums end up in Client.cpu/rss, next to the
+ * title if showclientstats is set, and in the _DWM_CLIENT_STATS root
+ * property as "window pid cpu% rss-KiB title" lines. */
+const char *
+clientstats(Client *c)
+{
+	static char buf[32];
+
+	if (c->rss >= 1024 * 1024)
+		snprintf(buf, sizeof buf, "%.0f%% %.1fG", c->cpu, c->rss / 1048576.0);
+	else
+		snprintf(buf, sizeof buf, "%.0f%% %luM", c->cpu, c->rss / 1024);
+	return buf;
+}
+
+static int
+cmpprocent(const void *a, const void *b)
+{
+	pid_t x = ((const ProcEnt *)a)->pid, y = ((const ProcEnt *)b)->pid;
+
+	return (x > y) - (x < y);
+}
+
+static ProcEnt *
+procfind(pid_t pid)
+{
+	ProcEnt key = { .pid = pid };
+
+	return bsearch(&key, procs.p, procs.n, sizeof(ProcEnt), cmpprocent);
+}
+
+/* diff the /proc listing against the table */
+static void
+proclist(void)
+{
+	struct dirent *e;
+	ProcEnt *p;
+	size_t i, j, n;
+	DIR *dp;
+	pid_t pid;
+
+	if (!(dp = opendir("/proc")))
+		return;
+	procs.gen++;
+	n = procs.n;
+	while ((e = readdir(dp))) {
+		if (!isdigit((unsigned char)e->d_name[0]))
+			continue;
+		pid = atoi(e->d_name);
+		if ((p = procfind(pid))) {
+			p->gen = procs.gen;
+			continue;
+		}
+		if (n == procs.cap) {
+			procs.cap = procs.cap ? procs.cap * 2 : 512;
+			if (!(procs.p = realloc(procs.p, procs.cap * sizeof(ProcEnt))))
+				die("realloc:");
+		}
+		/* appended past procs.n, so lookups above only see the sorted part */
+		memset(&procs.p[n], 0, sizeof(ProcEnt));
+		procs.p[n].pid = pid;
+		procs.p[n].gen = procs.gen;
+		procs.p[n++].fresh = 1;
+	}
+	closedir(dp);
+	for (i = j = 0; i < n; i++)
+		if (procs.p[i].gen == procs.gen)
+			procs.p[j++] = procs.p[i];
+	procs.n = j;
+	qsort(procs.p, procs.n, sizeof(ProcEnt), cmpprocent);
+}
+
+static void
+procread(ProcEnt *p)
+{
+	char path[64], buf[512], *s;
+	unsigned long long ut, st;
+	unsigned long rss;
+	int ppid, fd;
+	ssize_t n;
+
+	snprintf(path, sizeof path, "/proc/%d/stat", p->pid);
+	if ((fd = open(path, O_RDONLY|O_CLOEXEC)) == -1)
+		return;
+	n = read(fd, buf, sizeof buf - 1);
+	close(fd);
+	if (n <= 0)
+		return;
+	buf[n] = '\0';
+	/* pid (comm) state ppid pgrp session tty tpgid flags minflt cminflt majflt cmajflt utime stime */
+	if (!(s = strrchr(buf, ')'))
+	|| sscanf(s + 1, " %*c %d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",
+	          &ppid, &ut, &st) != 3)
+		return;
+	p->ppid = ppid;
+	p->prev = p->fresh ? ut + st : p->ticks;
+	p->ticks = ut + st;
+	p->fresh = 0;
+	if (!p->root)
+		return;
+	snprintf(path, sizeof path, "/proc/%d/statm", p->pid);
+	if ((fd = open(path, O_RDONLY|O_CLOEXEC)) == -1)
+		return;
+	n = read(fd, buf, sizeof buf - 1);
+	close(fd);
+	if (n > 0 && (buf[n] = '\0', sscanf(buf, "%*u %lu", &rss) == 1))
+		p->rss = rss;
+}
+
+static int
+isclientpid(pid_t pid)
+{
+	Monitor *m;
+	Client *c;
+
+	for (m = mons; m; m = m->next)
+		for (c = m->clients; c; c = c->next)
+			if (c->pid == pid)
+				return 1;
+	return 0;
+}
+
+/* attribute every process to the closest client process above it */
+static void
+procowners(void)
+{
+	ProcEnt *p, *q;
+	size_t i;
+	pid_t root;
+	int depth;
+
+	for (i = 0; i < procs.n; i++) {
+		p = &procs.p[i];
+		root = p->root;
+		p->root = 0;
+		for (q = p, depth = 0; q && q->pid > 1 && depth < 64; depth++) {
+			if (isclientpid(q->pid)) {
+				p->root = q->pid;
+				break;
+			}
+			q = q->ppid && q->ppid != q->pid ? procfind(q->ppid) : NULL;
+		}
+		/* untracked entries are not read, their ticks are stale: count
+		 * nothing now and start over at the next read */
+		if (p->root && !root) {
+			p->prev = p->ticks;
+			p->fresh = 1;
+		}
+	}
+}
+
+static void
+procpublish(long elapsed)
+{
+	static char *buf;
+	static size_t cap;
+	double hz = sysconf(_SC_CLK_TCK), kpage = sysconf(_SC_PAGESIZE) / 1024.0;
+	unsigned long long ticks;
+	unsigned long pages;
+	size_t i, len = 0, need;
+	Monitor *m;
+	Client *c;
+	char line[sizeof c->name + 64];
+	int dirty;
+
+	for (m = mons; m; m = m->next) {
+		dirty = 0;
+		for (c = m->clients; c; c = c->next) {
+			if (!c->pid)
+				continue;
+			ticks = 0;
+			pages = 0;
+			for (i = 0; i < procs.n; i++)
+				if (procs.p[i].root == c->pid) {
+					ticks += procs.p[i].ticks - procs.p[i].prev;
+					pages += procs.p[i].rss;
+				}
+			c->cpu = elapsed > 0 ? ticks * 100000.0 / hz / elapsed : 0;
+			c->rss = pages * kpage;
+			dirty |= c == m->sel;
+			need = snprintf(line, sizeof line, "0x%lx %d %.1f %lu %s\n",
+			                c->win, c->pid, c->cpu, c->rss, c->name);
+			if (len + need + 1 > cap) {
+				cap = (len + need + 1) * 2;
+				if (!(buf = realloc(buf, cap)))
+					die("realloc:");
+			}
+			memcpy(buf + len, line, MIN(need, sizeof line - 1));
+			len += MIN(need, sizeof line - 1);
+		}
+		if (dirty && showclientstats)
+			drawbar(m);
+	}
+	XChangeProperty(dpy, root, statsatom, utf8string, 8,
+		PropModeReplace, (unsigned char *)(buf ? buf : ""), len);
+}
+
+/* do a slice of sampling work if any is due; returns msec until more work
+ * is due, 0 if a pass is half done, -1 if sampling is off */
+long
+procsample(void)
+{
+	long now;
+	size_t end;
+
+	if (!clientstatsinterval)
+		return -1;
+	now = msec();
+	if (!procs.busy) {
+		if (now < procs.next)
+			return procs.next - now;
+		proclist();
+		procs.cursor = 0;
+		procs.busy = 1;
+		return 0;
+	}
+	for (end = MIN(procs.cursor + 32, procs.n); procs.cursor < end; procs.cursor++)
+		if (procs.p[procs.cursor].fresh || procs.p[procs.cursor].root)
+			procread(&procs.p[procs.cursor]);
+	if (procs.cursor < procs.n)
+		return 0;
+	/* new processes are only read once their parent is known */
+	procowners();
+	procpublish(procs.last ? now - procs.last : 0);
+	procs.last = now;
+	procs.busy = 0;
+	procs.next = now + clientstatsinterval;
+	return clientstatsinterval;
+}
+
+/* X event record/replay.
+ *
+ * The log is EVLOGMAGIC followed by EvRecords. Event records carry the raw
+ * Xlib event struct of the handled types, so a log is only portable between
+ * builds of the same ABI. Server specific ids are made portable by meta
+ * records: atom names, keycode to keysym mappings and dwm's own windows
+ * (root, bars, systray) are written the first time they are seen, and
+ * replay maps them onto the ids of the replaying server. */
+static const size_t evsize[LASTEvent] = {
+	[ButtonPress] = sizeof(XButtonEvent),
+	[ClientMessage] = sizeof(XClientMessageEvent),
+	[ConfigureRequest] = sizeof(XConfigureRequestEvent),
+	[ConfigureNotify] = sizeof(XConfigureEvent),
+	[DestroyNotify] = sizeof(XDestroyWindowEvent),
+	[EnterNotify] = sizeof(XCrossingEvent),
+	[Expose] = sizeof(XExposeEvent),
+	[FocusIn] = sizeof(XFocusChangeEvent),
+	[KeyPress] = sizeof(XKeyEvent),
+	[MappingNotify] = sizeof(XMappingEvent),
+	[MapRequest] = sizeof(XMapRequestEvent),
+	[MotionNotify] = sizeof(XMotionEvent),
+	[PropertyNotify] = sizeof(XPropertyEvent),
+	[ResizeRequest] = sizeof(XResizeRequestEvent),
+	[UnmapNotify] = sizeof(XUnmapEvent),
+};
+
+static const char *evname[LASTEvent] = {
+	[ButtonPress] = "ButtonPress",
+	[ClientMessage] = "ClientMessage",
+	[ConfigureRequest] = "ConfigureRequest",
+	[ConfigureNotify] = "ConfigureNotify",
+	[DestroyNotify] = "DestroyNotify",
+	[EnterNotify] = "EnterNotify",
+	[Expose] = "Expose",
+	[FocusIn] = "FocusIn",
+	[KeyPress] = "KeyPress",
+	[MappingNotify] = "MappingNotify",
+	[MapRequest] = "MapRequest",
+	[MotionNotify] = "MotionNotify",
+	[PropertyNotify] = "PropertyNotify",
+	[ResizeRequest] = "ResizeRequest",
+	[UnmapNotify] = "UnmapNotify",
+};
+
+static struct timespec evlast;
+static Atom *evatoms;               /* atoms already defined in the log */
+static size_t nevatoms, evatomcap;
+static unsigned char evkeys[256 / 8]; /* keycodes already defined */
+
+static long
+evusec(struct timespec *a, struct timespec *b)
+{
+	return (b->tv_sec - a->tv_sec) * 1000000L + (b->tv_nsec - a->tv_nsec) / 1000;
+}
+
+static void
+evput(uint8_t type, uint32_t dt, const void *p1, size_t n1, const void *p2, size_t n2)
+{
+	EvRecord r = { .dt = dt, .type = type, .len = n1 + n2 };
+
+	fwrite(&r, sizeof r, 1, evlog);
+	fwrite(p1, 1, n1, evlog);
+	if (n2)
+		fwrite(p2, 1, n2, evlog);
+}
+
+static void
+evputatom(Atom a)
+{
+	uint32_t id = a;
+	char *name;
+	size_t i;
+
+	if (a == None)
+		return;
+	for (i = 0; i < nevatoms; i++)
+		if (evatoms[i] == a)
+			return;
+	if (!(name = XGetAtomName(dpy, a)))
+		return;
+	if (nevatoms == evatomcap) {
+		evatomcap = evatomcap ? evatomcap * 2 : 64;
+		if (!(evatoms = realloc(evatoms, evatomcap * sizeof(Atom))))
+			die("realloc:");
+	}
+	evatoms[nevatoms++] = a;
+	evput(EvAtom, 0, &id, sizeof id, name, strlen(name));
+	XFree(name);
+}
+
+static void
+evputalias(Window w, uint8_t kind, uint8_t idx)
+{
+	uint32_t id = w;
+	uint8_t ki[2] = { kind, idx };
+
+	if (w)
+		evput(EvAlias, 0, &id, sizeof id, ki, sizeof ki);
+}
+
+void
+evlogopen(const char *path)
+{
+	Monitor *m;
+
+	if (!(evlog = fopen(path, "wb")))
+		die("dwm: cannot open event log '%s':", path);
+	fwrite(EVLOGMAGIC, 1, sizeof EVLOGMAGIC - 1, evlog);
+	evputalias(root, AliasRoot, 0);
+	for (m = mons; m; m = m->next)
+		evputalias(m->barwin, AliasBar, m->num);
+	evputalias(systray ? systray->win : 0, AliasSystray, 0);
+	evputalias(wmcheckwin, AliasCheck, 0);
+	clock_gettime(CLOCK_MONOTONIC, &evlast);
+}
+
+void
+evlogwrite(XEvent *ev)
+{
+	struct timespec now;
+	uint32_t kk[2];
+	long dt;
+
+	if (!evsize[ev->type])
+		return;
+	if (ev->type == PropertyNotify)
+		evputatom(ev->xproperty.atom);
+	else if (ev->type == ClientMessage) {
+		evputatom(ev->xclient.message_type);
+		if (ev->xclient.message_type == netatom[NetWMState]) {
+			evputatom(ev->xclient.data.l[1]);
+			evputatom(ev->xclient.data.l[2]);
+		}
+	} else if (ev->type == KeyPress && !(evkeys[ev->xkey.keycode / 8] & 1 << ev->xkey.keycode % 8)) {
+		evkeys[ev->xkey.keycode / 8] |= 1 << ev->xkey.keycode % 8;
+		kk[0] = ev->xkey.keycode;
+		kk[1] = XKeycodeToKeysym(dpy, (KeyCode)ev->xkey.keycode, 0);
+		evput(EvKey, 0, kk, sizeof kk, NULL, 0);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	dt = evusec(&evlast, &now);
+	evlast = now;
+	evput(ev->type, dt > UINT32_MAX ? UINT32_MAX : dt, ev, evsize[ev->type], NULL, 0);
+}
+
+typedef struct {
+	unsigned long from, to;
+	int standin;                /* window created by the replay client */
+} EvMap;
+
+static EvMap *evmap;
+static size_t nevmap, evmapcap;
+static KeyCode evkeymap[256];
+
+static unsigned long
+evlookup(unsigned long from, int *found)
+{
+	size_t i;
+
+	for (i = 0; i < nevmap; i++)
+		if (evmap[i].from == from) {
+			*found = 1 + evmap[i].standin;
+			return evmap[i].to;
+		}
+	*found = 0;
+	return from;
+}
+
+static void
+evmapadd(unsigned long from, unsigned long to, int standin)
+{
+	if (nevmap == evmapcap) {
+		evmapcap = evmapcap ? evmapcap * 2 : 64;
+		if (!(evmap = realloc(evmap, evmapcap * sizeof(EvMap))))
+			die("realloc:");
+	}
+	evmap[nevmap].from = from;
+	evmap[nevmap].to = to;
+	evmap[nevmap++].standin = standin;
+}
+
+/* translate a recorded window; unknown client windows get a stand-in,
+ * created on a separate connection so that the replayed map request
+ * makes dwm manage and map it */
+static Window
+evwin(Display *cdpy, Window w, int create)
+{
+	int found;
+	Window r;
+
+	if (!w)
+		return w;
+	r = evlookup(w, &found);
+	if (found || !create)
+		return r;
+	r = XCreateSimpleWindow(cdpy, root, 0, 0, 640, 480, 0, 0, 0);
+	XSync(cdpy, False);
+	evmapadd(w, r, 1);
+	return r;
+}
+
+static int
+cmplong(const void *a, const void *b)
+{
+	long x = *(const long *)a, y = *(const long *)b;
+
+	return (x > y) - (x < y);
+}
+
+void
+evreplay(const char *path)
+{
+	FILE *f;
+	Display *cdpy;
+	EvRecord r;
+	XEvent ev, junk;
+	struct timespec t0, t1;
+	char magic[sizeof EVLOGMAGIC - 1], buf[sizeof(XEvent) + 256];
+	long *lat[LASTEvent] = { 0 }, us, total = 0;
+	size_t nlat[LASTEvent] = { 0 }, cap[LASTEvent] = { 0 }, i, n = 0;
+	uint32_t id, sym;
+	Monitor *m;
+	int found = 0;
+
+	if (!(f = fopen(path, "rb")))
+		die("dwm: cannot open event log '%s':", path);
+	if (fread(magic, 1, sizeof magic, f) != sizeof magic || memcmp(magic, EVLOGMAGIC, sizeof magic))
+		die("dwm: '%s' is not an event log", path);
+	if (!(cdpy = XOpenDisplay(NULL)))
+		die("dwm: cannot open replay client display");
+	replaying = 1;
+
+	while (fread(&r, sizeof r, 1, f) == 1) {
+		if (r.len >= sizeof buf || fread(buf, 1, r.len, f) != r.len)
+			die("dwm: truncated event log");
+		memcpy(&id, buf, sizeof id);
+		buf[r.len] = '\0';
+		switch (r.type) {
+		case EvAtom:
+			evmapadd(id, XInternAtom(dpy, buf + sizeof id, False), 0);
+			continue;
+		case EvAlias:
+			if (buf[4] == AliasRoot)
+				evmapadd(id, root, 0);
+			else if (buf[4] == AliasBar) {
+				for (m = mons; m && m->num != buf[5]; m = m->next);
+				if (m)
+					evmapadd(id, m->barwin, 0);
+			} else if (buf[4] == AliasSystray && systray)
+				evmapadd(id, systray->win, 0);
+			else if (buf[4] == AliasCheck)
+				evmapadd(id, wmcheckwin, 0);
+			continue;
+		case EvKey:
+			memcpy(&sym, buf + sizeof id, sizeof sym);
+			evkeymap[id & 0xff] = XKeysymToKeycode(dpy, sym);
+			continue;
+		}
+		if (r.type >= LASTEvent || !handler[r.type] || r.len != evsize[r.type])
+			continue;
+
+		memset(&ev, 0, sizeof ev);
+		memcpy(&ev, buf, r.len);
+		ev.xany.display = dpy;
+		ev.xany.window = evwin(cdpy, ev.xany.window, 0);
+		switch (ev.type) {
+		case MapRequest:
+			ev.xmaprequest.window = evwin(cdpy, ev.xmaprequest.window, 1);
+			break;
+		case ConfigureRequest:
+			ev.xconfigurerequest.window = evwin(cdpy, ev.xconfigurerequest.window, 1);
+			ev.xconfigurerequest.above = evwin(cdpy, ev.xconfigurerequest.above, 0);
+			break;
+		case ConfigureNotify:
+			ev.xconfigure.window = evwin(cdpy, ev.xconfigure.window, 0);
+			ev.xconfigure.above = evwin(cdpy, ev.xconfigure.above, 0);
+			break;
+		case DestroyNotify:
+			ev.xdestroywindow.window = evlookup(ev.xdestroywindow.window, &found);
+			break;
+		case UnmapNotify:
+			ev.xunmap.window = evwin(cdpy, ev.xunmap.window, 0);
+			break;
+		case PropertyNotify:
+			ev.xproperty.atom = evlookup(ev.xproperty.atom, &found);
+			break;
+		case ClientMessage:
+			ev.xclient.message_type = evlookup(ev.xclient.message_type, &found);
+			if (ev.xclient.message_type == netatom[NetWMState])
+				for (i = 1; i <= 2; i++)
+					ev.xclient.data.l[i] = evlookup(ev.xclient.data.l[i], &found);
+			break;
+		case KeyPress:
+			ev.xkey.keycode = evkeymap[ev.xkey.keycode & 0xff];
+			/* fallthrough */
+		case ButtonPress:
+		case MotionNotify:
+		case EnterNotify:
+			ev.xkey.root = root;
+			ev.xkey.subwindow = evwin(cdpy, ev.xkey.subwindow, 0);
+			break;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		handler[ev.type](&ev);
+		XSync(dpy, False);
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		us = evusec(&t0, &t1);
+		if (nlat[ev.type] == cap[ev.type]) {
+			cap[ev.type] = cap[ev.type] ? cap[ev.type] * 2 : 256;
+			if (!(lat[ev.type] = realloc(lat[ev.type], cap[ev.type] * sizeof(long))))
+				die("realloc:");
+		}
+		lat[ev.type][nlat[ev.type]++] = us;
+		total += us;
+		n++;
+
+		if (ev.type == DestroyNotify && found == 2)
+			XDestroyWindow(cdpy, ev.xdestroywindow.window);
+		/* what the server reports back is already part of the log */
+		XSync(cdpy, False);
+		while (XPending(dpy))
+			XNextEvent(dpy, &junk);
+	}
+	fclose(f);
+	replaying = 0;
+
+	printf("dwm: replayed %zu events in %ld us\n", n, total);
+	printf("%-18s %7s %9s %7s %7s %7s %8s\n", "event", "n", "total", "avg", "p50", "p99", "max");
+	for (i = 0; i < LASTEvent; i++) {
+		if (!nlat[i])
+			continue;
+		qsort(lat[i], nlat[i], sizeof(long), cmplong);
+		for (us = 0, n = 0; n < nlat[i]; n++)
+			us += lat[i][n];
+		printf("%-18s %7zu %9ld %7ld %7ld %7ld %8ld\n", evname[i], nlat[i], us,
+		       us / (long)nlat[i], lat[i][nlat[i] / 2], lat[i][nlat[i] * 99 / 100],
+		       lat[i][nlat[i] - 1]);
+		free(lat[i]);
+	}
+	free(evmap);
+	XCloseDisplay(cdpy);
+}
+
+int
+main(int argc, char *argv[])
+{
+	const char *recpath = NULL, *replaypath = NULL;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp("-v", argv[i]))
+			die("dwm-"VERSION);
+		else if (!strcmp("-r", argv[i]) && i + 1 < argc)
+			recpath = argv[++i];
+		else if (!strcmp("-p", argv[i]) && i + 1 < argc)
+			replaypath = argv[++i];
+		else
+			die("usage: dwm [-v] [-r eventlog | -p eventlog]");
+	}
+	if (!setlocale(LC_CTYPE, "") || !XSupportsLocale())
+		fputs("warning: no locale support\n", stderr);
+	if (!(dpy = XOpenDisplay(NULL)))
+		die("dwm: cannot open display");
+	checkotherwm();
+	XrmInitialize();
+	load_xresources();
+	setup();
+	if (replaypath) {
+		evreplay(replaypath);
+		running = 0;
+		cleanup();
+		XCloseDisplay(dpy);
+		return EXIT_SUCCESS;
+	}
+	if (recpath)
+		evlogopen(recpath);
 #ifdef __OpenBSD__
 	if (pledge("stdio rpath proc exec", NULL) == -1)
 		die("pledge");
 #endif /* __OpenBSD__ */
 	scan();
+#ifndef BENCH
+	spawnscratchpads();
 	runAutostart();
+#endif /* BENCH */
 	run();
 	cleanup();
 	XCloseDisplay(dpy);
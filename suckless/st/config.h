@@ -53,6 +53,13 @@ static char *font2[] = {
 	setting the clipboard text */
  int allowwindowops = 0;
  
+ /*
+  * scrollback depth in lines. History is stored compactly (attribute runs and
+  * UTF-8 text, trailing blanks trimmed), so 100k lines of a build log cost a
+  * few MB rather than hundreds.
+  */
+ int histsize = 100000;
+ 
  /*
   * draw latency range in ms - from new content/keypress/etc until drawing.
   * within this range, st draws when content stops arriving (idle). mostly it's
@@ -224,6 +231,7 @@ ResourcePref resources[] = {
 		{ "borderpx",     INTEGER, &borderpx },
 		{ "cwscale",      FLOAT,   &cwscale },
 		{ "chscale",      FLOAT,   &chscale },
+		{ "histsize",     INTEGER, &histsize },
 };
  
  /*
@@ -544,4 +552,14 @@ char urlchars[] =
 	"0123456789-._~:/?#@!$&'*+,;=%";
 char *urlprefixes[] = { "http://", "https://", NULL };
 int nurlprefixes = 2;
+
+/*
+ * Cell width of private use code points, which Unicode leaves to the font:
+ * { first, last, width }. The first matching range wins, anything else is
+ * one cell. Set the Nerd Font icon ranges to 2 for a non-Propo font.
+ */
+const Rune privatewidths[][3] = {
+	{ 0xe000, 0xf8ff, 1 },
+};
+const int nprivatewidths = LEN(privatewidths);
  
\ No newline at end of file
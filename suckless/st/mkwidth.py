@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+# Generate width_data.h, the two-stage cell width table used by runewidth().
+#
+#   ./mkwidth.py > width_data.h
+#
+# Widths come from the unicodedata module of the Python running this, so
+# regenerate with a recent Python after a Unicode update.
+import sys
+import unicodedata
+
+BLOCK = 256
+PRIVATE = 3  # resolved at run time from config.h
+
+
+def width(u):
+    if 0xe000 <= u <= 0xf8ff or 0xf0000 <= u <= 0xffffd \
+            or 0x100000 <= u <= 0x10fffd:
+        return PRIVATE
+    c = chr(u)
+    cat = unicodedata.category(c)
+    # soft hyphen and the prepended concatenation marks are visible
+    if u in (0x00ad, 0x06dd, 0x070f, 0x08e2, 0x110bd, 0x110cd) \
+            or 0x0600 <= u <= 0x0605 or 0x0890 <= u <= 0x0891:
+        return 1
+    # combining marks, format chars and the Hangul vowels and finals that
+    # join a preceding syllable
+    if cat in ("Mn", "Me", "Cf") or 0x1160 <= u <= 0x11ff \
+            or 0xd7b0 <= u <= 0xd7ff or u == 0x200b:
+        return 0
+    if cat == "Cn":
+        # unassigned code points are wide in the CJK blocks only
+        return 2 if 0x3400 <= u <= 0x4dbf or 0x4e00 <= u <= 0x9fff \
+            or 0xf900 <= u <= 0xfaff or 0x20000 <= u <= 0x3fffd else 1
+    if unicodedata.east_asian_width(c) in ("W", "F"):
+        return 2
+    return 1
+
+
+def main():
+    blocks, index = [], []
+    seen = {}
+    for b in range(0x110000 // BLOCK):
+        blk = tuple(width(u) for u in range(b * BLOCK, (b + 1) * BLOCK))
+        if blk not in seen:
+            seen[blk] = len(blocks)
+            blocks.append(blk)
+        index.append(seen[blk])
+    if len(blocks) > 256:
+        sys.exit("mkwidth.py: too many distinct blocks")
+
+    out = sys.stdout
+    out.write("/* generated by mkwidth.py from Unicode %s, do not edit */\n\n"
+              % unicodedata.unidata_version)
+    out.write("#define WIDTH_PRIVATE %d\n\n" % PRIVATE)
+    out.write("/* block of each 256 code points */\n")
+    out.write("static const uchar widthblock[%d] = {\n" % len(index))
+    for i in range(0, len(index), 16):
+        out.write("\t" + ", ".join("%d" % v for v in index[i:i + 16]) + ",\n")
+    out.write("};\n\n")
+    out.write("/* 2 bits per code point, 4 per byte, low bits first */\n")
+    out.write("static const uchar widthdata[%d][%d] = {\n"
+              % (len(blocks), BLOCK // 4))
+    for blk in blocks:
+        packed = [blk[i] | blk[i + 1] << 2 | blk[i + 2] << 4 | blk[i + 3] << 6
+                  for i in range(0, BLOCK, 4)]
+        out.write("\t{\n")
+        for i in range(0, len(packed), 16):
+            out.write("\t\t" + ", ".join("0x%02x" % v
+                                         for v in packed[i:i + 16]) + ",\n")
+        out.write("\t},\n")
+    out.write("};\n")
+
+
+if __name__ == "__main__":
+    main()
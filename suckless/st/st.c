@@ -14,11 +14,13 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <termios.h>
+#include <time.h>
 #include <unistd.h>
 #include <wchar.h>
 
 #include "st.h"
 #include "win.h"
+#include "width_data.h"
 
 #if   defined(__linux)
  #include <pty.h>
@@ -28,6 +30,10 @@
  #include <libutil.h>
 #endif
 
+#ifdef __SSE2__
+ #include <emmintrin.h>
+#endif
+
 /* Arbitrary sizes */
 #define UTF_INVALID   0xFFFD
 #define UTF_SIZ       4
@@ -35,7 +41,9 @@
 #define ESC_ARG_SIZ   16
 #define STR_BUF_SIZ   ESC_BUF_SIZ
 #define STR_ARG_SIZ   ESC_ARG_SIZ
-#define HISTSIZE      2000
+#define TTY_BUF_MAX   (1 << 20)
+#define TTY_WRITE_MIN 256
+#define TTY_WRITE_MAX (64*1024)
 
 /* macros */
 #define IS_SET(flag)		((term.mode & (flag)) != 0)
@@ -43,9 +51,11 @@
 #define ISCONTROLC1(c)		(BETWEEN(c, 0x80, 0x9f))
 #define ISCONTROL(c)		(ISCONTROLC0(c) || ISCONTROLC1(c))
 #define ISDELIM(u)		(u && wcschr(worddelimiters, u))
-#define TLINE(y)		((y) < term.scr ? term.hist[((y) + term.histi - \
-            term.scr + HISTSIZE + 1) % HISTSIZE] : \
-            term.line[(y) - term.scr])
+#define ONES8			((uint64_t)-1 / 0xff)
+/* no byte of the 8 in v is a control code or above 0x7e */
+#define ISPRINT8(v)		(!(((v) | ((v) + ONES8) | (((v) - ONES8 * 0x20) & ~(v))) \
+				& ONES8 * 0x80))
+#define TLINE(y)		tline(y)
 
 enum term_mode {
 	MODE_WRAP        = 1 << 0,
@@ -113,16 +123,54 @@ typedef struct {
 	int alt;
 } Selection;
 
+/* Dirty columns of a line, none if x1 > x2 */
+typedef struct {
+	int x1, x2;
+} Dirty;
+
+/* History entry: a logical line, i.e. rows joined by soft wraps */
+typedef struct {
+	uchar *buf;   /* attribute runs, see histencode() */
+	size_t len;   /* nb of bytes in buf */
+	int w;        /* width rows and x were laid out at, 0 if none */
+	int rows;     /* nb of rows at width w */
+	int x;        /* nb of cells used on the last row */
+	int open;     /* last row pushed was soft wrapped */
+} HistLine;
+
+/* History row expanded for display */
+typedef struct {
+	Line line;
+	int col;      /* nb of glyphs in line */
+	long e;       /* history entry, -1 if unused */
+	int sub;      /* row within the entry */
+} HistCache;
+
+/* Scroll not yet shown, see tqueuescroll() */
+typedef struct {
+	int top;      /* first row of the region */
+	int bot;      /* last row of the region */
+	int n;        /* nb of rows moved up, negative for down */
+} Scroll;
+
 /* Internal representation of the screen */
 typedef struct {
 	int row;      /* nb row */
 	int col;      /* nb col */
 	Line *line;   /* screen */
 	Line *alt;    /* alternate screen */
-	Line hist[HISTSIZE]; /* history buffer */
-	int histi;    /* history index */
+	HistLine *hist; /* history ring of histsize entries */
+	long histpushed; /* nb of entries ever pushed to history */
+	int histn;    /* nb of history entries in use */
+	long histcur; /* entry last looked up by histrow() */
+	int histend;  /* nb of history rows below histcur */
+	int histw;    /* width histcur/histend were counted at */
+	HistCache *histcache; /* expanded history rows, one per row */
 	int scr;      /* scroll back */
-	int *dirty;   /* dirtyness of lines */
+	Dirty *dirty; /* dirty columns of lines */
+	ushort *lattr; /* modes that may be set on cells of each line */
+	Scroll scroll[8]; /* scrolls since the last draw */
+	int nscroll;  /* nb of scrolls in scroll */
 	TCursor c;    /* cursor */
 	int ocx;      /* old cursor col */
 	int ocy;      /* old cursor row */
@@ -185,18 +233,31 @@ static void tdeletechar(int);
 static void tdeleteline(int);
 static void tinsertblank(int);
 static void tinsertblankline(int);
+static Line tline(int);
+static int glyphblank(const Glyph *);
+static uchar *histencode(const Glyph *, const Glyph *, size_t *);
+static int histpush(const Glyph *, int);
+static int histrows(HistLine *);
+static void histlayout(HistLine *, const uchar *, const uchar *);
+static int histrow(int, long *, int *);
+static int histavail(int);
+static void histdecode(HistLine *, int, Line, int);
 static int tlinelen(int);
 static void tmoveto(int, int);
 static void tmoveato(int, int);
 static void tnewline(int);
 static void tputtab(int);
 static void tputc(Rune);
+static int tputascii(const char *, int);
 static void treset(void);
 static void tscrollup(int, int, int);
-static void tscrolldown(int, int, int);
+static void tscrolldown(int, int);
+static int tqueuescroll(int, int);
 static void tsetattr(const int *, int);
+static void treflow(int, int);
 static void tsetchar(Rune, const Glyph *, int, int);
 static void tsetdirt(int, int);
+static inline void tsetdirtx(int, int, int);
 static void tsetscroll(int, int);
 static void tswapscreen(void);
 static void tsetmode(int, int, const int *, int);
@@ -215,7 +276,9 @@ static void selnormalize(void);
 static void selscroll(int, int);
 static void selsnap(int *, int *, int);
 
+static inline int runewidth(Rune);
 static size_t utf8decode(const char *, Rune *, size_t);
+static size_t utf8decoderun(const char *, size_t, Rune *, int, int *);
 static Rune utf8decodebyte(char, size_t *);
 static char utf8encodebyte(Rune, size_t);
 static size_t utf8validate(Rune *, size_t);
@@ -234,6 +297,11 @@ static int iofd = 1;
 static int cmdfd;
 static pid_t pid;
 
+/* bytes queued for the tty, see ttyflush() */
+static char *wbuf;
+static size_t wbufsiz, wbufoff, wbuflen;
+static size_t wlim = TTY_WRITE_MIN;
+
 static const uchar utfbyte[UTF_SIZ + 1] = {0x80,    0, 0xC0, 0xE0, 0xF0};
 static const uchar utfmask[UTF_SIZ + 1] = {0xC0, 0x80, 0xE0, 0xF0, 0xF8};
 static const Rune utfmin[UTF_SIZ + 1] = {       0,    0,  0x80,  0x800,  0x10000};
@@ -312,6 +380,93 @@ utf8decode(const char *c, Rune *u, size_t clen)
 	return len;
 }
 
+/*
+ * Nb of cells taken by u, from the table generated by mkwidth.py, with
+ * private use code points looked up in privatewidths from config.h.
+ */
+int
+runewidth(Rune u)
+{
+	int i, w;
+
+	if (u > 0x10ffff)
+		return 1;
+	w = widthdata[widthblock[u >> 8]][(u & 0xff) >> 2] >> (u & 3) * 2 & 3;
+	if (w != WIDTH_PRIVATE)
+		return w;
+	for (i = 0; i < nprivatewidths; i++) {
+		if (BETWEEN(u, privatewidths[i][0], privatewidths[i][1]))
+			return privatewidths[i][2];
+	}
+	return 1;
+}
+
+/*
+ * Decode the run of well-formed multibyte sequences at the start of c
+ * into at most max runes. The run ends at ASCII, at an invalid or
+ * incomplete sequence and at the end of c, all left to utf8decode().
+ * Returns the nb of bytes decoded, *nr gets the nb of runes.
+ */
+size_t
+utf8decoderun(const char *c, size_t clen, Rune *u, int max, int *nr)
+{
+	const uchar *p = (const uchar *)c, *end = p;
+	Rune r;
+	int i = 0, len;
+
+	/* no ASCII byte can be part of the run */
+#ifdef __SSE2__
+	for (; end + 16 <= p + clen; end += 16) {
+		len = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)end));
+		if (len != 0xffff) {
+			end += __builtin_ctz(~len);
+			goto scanned;
+		}
+	}
+#endif
+	while (end < p + clen && *end >= 0x80)
+		end++;
+#ifdef __SSE2__
+scanned:
+#endif
+
+	while (i < max && p < end) {
+		if (p[0] < 0xc2) {
+			break;
+		} else if (p[0] < 0xe0) {
+			if (end - p < 2 || (p[1] & 0xc0) != 0x80)
+				break;
+			r = (p[0] & 0x1f) << 6 | (p[1] & 0x3f);
+			len = 2;
+		} else if (p[0] < 0xf0) {
+			if (end - p < 3 || (p[1] & 0xc0) != 0x80
+			    || (p[2] & 0xc0) != 0x80)
+				break;
+			r = (p[0] & 0x0f) << 12 | (p[1] & 0x3f) << 6
+			  | (p[2] & 0x3f);
+			if (r < 0x800 || BETWEEN(r, 0xd800, 0xdfff))
+				break;
+			len = 3;
+		} else if (p[0] < 0xf5) {
+			if (end - p < 4 || (p[1] & 0xc0) != 0x80
+			    || (p[2] & 0xc0) != 0x80 || (p[3] & 0xc0) != 0x80)
+				break;
+			r = (p[0] & 0x07) << 18 | (p[1] & 0x3f) << 12
+			  | (p[2] & 0x3f) << 6 | (p[3] & 0x3f);
+			if (!BETWEEN(r, 0x10000, 0x10ffff))
+				break;
+			len = 4;
+		} else {
+			break;
+		}
+		u[i++] = r;
+		p += len;
+	}
+	*nr = i;
+
+	return p - (const uchar *)c;
+}
+
 Rune
 utf8decodebyte(char c, size_t *i)
 {
@@ -411,6 +566,312 @@ selinit(void)
 	sel.ob.x = -1;
 }
 
+static uchar *
+putvarint(uchar *p, uint32_t v)
+{
+	for (; v >= 0x80; v >>= 7)
+		*p++ = v | 0x80;
+	*p++ = v;
+	return p;
+}
+
+static uint32_t
+getvarint(const uchar **p)
+{
+	uint32_t v = 0;
+	int shift = 0;
+
+	do
+		v |= (uint32_t)(**p & 0x7f) << shift, shift += 7;
+	while (*(*p)++ & 0x80);
+	return v;
+}
+
+int
+glyphblank(const Glyph *gp)
+{
+	return gp->u == ' ' && !(gp->mode & ~(ATTR_WRAP|ATTR_WPAD))
+	       && gp->fg == defaultfg && gp->bg == defaultbg;
+}
+
+/*
+ * History entries are stored as attribute runs: varint ncells, mode, fg
+ * and bg, then the ncells runes of the run UTF-8 encoded. The dummy cells
+ * behind wide glyphs and the pads before wide glyphs moved to the next row
+ * are not stored. Returns a buffer valid until the next call.
+ */
+uchar *
+histencode(const Glyph *gp, const Glyph *end, size_t *len)
+{
+	static uchar *buf;
+	static size_t bufsiz;
+	const Glyph *q;
+	uchar *p;
+	uint32_t n;
+	ushort mode;
+
+	/* at worst a run of its own for each cell */
+	if (bufsiz < (end - gp) * (5 * 4 + UTF_SIZ)) {
+		bufsiz = (end - gp) * (5 * 4 + UTF_SIZ);
+		buf = xrealloc(buf, bufsiz);
+	}
+	p = buf;
+	while (gp < end) {
+		if (gp->mode & ATTR_WPAD) {
+			gp++;
+			continue;
+		}
+		mode = gp->mode & ~ATTR_WRAP;
+		for (n = 0, q = gp; q < end && (q->mode & ~ATTR_WRAP) == mode
+		     && q->fg == gp->fg && q->bg == gp->bg; n++)
+			q += (mode & ATTR_WIDE) ? 2 : 1;
+		p = putvarint(p, n);
+		p = putvarint(p, mode);
+		p = putvarint(p, gp->fg);
+		p = putvarint(p, gp->bg);
+		for (; gp < q; gp += (mode & ATTR_WIDE) ? 2 : 1)
+			p += utf8encode(gp->u, (char *)p);
+	}
+	*len = p - buf;
+	return buf;
+}
+
+/*
+ * Push a screen row of col glyphs to history. A row following a soft
+ * wrapped one is appended to the same entry; trailing blanks are only
+ * dropped at the end of an entry. Returns the nb of history rows added
+ * at the current width.
+ */
+int
+histpush(const Glyph *line, int col)
+{
+	HistLine *h;
+	const Glyph *end = &line[col];
+	uchar *enc;
+	size_t len;
+	long e = term.histpushed - 1;
+	int i, before;
+
+	if (histsize <= 0)
+		return 0;
+
+	if (term.histn > 0 && term.hist[e % histsize].open) {
+		h = &term.hist[e % histsize];
+		/* the last row of the entry is going to change */
+		for (i = 0; i < term.row; i++) {
+			if (term.histcache[i].e == e)
+				term.histcache[i].e = -1;
+		}
+	} else {
+		e = term.histpushed++;
+		h = &term.hist[e % histsize];
+		free(h->buf);
+		*h = (HistLine){ 0 };
+		if (term.histn < histsize)
+			term.histn++;
+	}
+	before = histrows(h);
+
+	h->open = (line[col-1].mode & ATTR_WRAP) != 0;
+	if (!h->open) {
+		while (end > line && glyphblank(&end[-1]))
+			end--;
+	}
+	if (end > line) {
+		enc = histencode(line, end, &len);
+		h->buf = xrealloc(h->buf, h->len + len);
+		memcpy(h->buf + h->len, enc, len);
+		histlayout(h, h->buf + h->len, h->buf + h->len + len);
+		h->len += len;
+	}
+
+	/* rows were added below the entry histrow() last stopped at */
+	if (term.histcur != e)
+		term.histend += h->rows - before;
+	return h->rows - before;
+}
+
+/* nb of rows of h at the current width */
+int
+histrows(HistLine *h)
+{
+	if (h->w != term.col) {
+		h->w = term.col;
+		h->rows = 1;
+		h->x = 0;
+		histlayout(h, h->buf, h->buf + h->len);
+	}
+	return h->rows;
+}
+
+/*
+ * Continue the layout of h over the runs from p to end. As in treflow(),
+ * a wide glyph that does not fit on a row moves to the next one whole.
+ */
+void
+histlayout(HistLine *h, const uchar *p, const uchar *end)
+{
+	uint32_t n;
+	size_t len;
+	int w;
+
+	while (p < end) {
+		n = getvarint(&p);
+		w = (getvarint(&p) & ATTR_WIDE) && h->w >= 2 ? 2 : 1;
+		getvarint(&p);
+		getvarint(&p);
+		for (; n--; p += len) {
+			utf8decodebyte(*p, &len);
+			if (h->x + w > h->w)
+				h->rows++, h->x = 0;
+			h->x += w;
+		}
+	}
+}
+
+/*
+ * Find history row r, counted upwards from the newest one, as row sub of
+ * entry e. Entries are rewrapped to the current width as they are walked,
+ * starting from where the previous lookup stopped, so scrolling through
+ * history only ever looks at the entries scrolled over.
+ */
+int
+histrow(int r, long *e, int *sub)
+{
+	int rows;
+
+	if (term.histn == 0 || r < 0)
+		return 0;
+	if (term.histw != term.col
+	    || term.histcur < term.histpushed - term.histn) {
+		term.histcur = term.histpushed - 1;
+		term.histend = 0;
+		term.histw = term.col;
+	}
+
+	while (r < term.histend) {
+		term.histcur++;
+		term.histend -= histrows(&term.hist[term.histcur % histsize]);
+	}
+	while (r >= term.histend
+	       + (rows = histrows(&term.hist[term.histcur % histsize]))) {
+		if (term.histcur == term.histpushed - term.histn)
+			return 0;
+		term.histend += rows;
+		term.histcur--;
+	}
+	*e = term.histcur;
+	*sub = rows - 1 - (r - term.histend);
+	return 1;
+}
+
+/* nb of history rows, up to n */
+int
+histavail(int n)
+{
+	long e;
+	int sub;
+
+	if (n <= 0 || histrow(n - 1, &e, &sub))
+		return MAX(n, 0);
+	if (term.histn == 0)
+		return 0;
+	return term.histend + histrows(&term.hist[term.histcur % histsize]);
+}
+
+/* expand row sub of entry h, laid out as by histlayout(), at col glyphs */
+void
+histdecode(HistLine *h, int sub, Line line, int col)
+{
+	const uchar *p = h->buf, *end = h->buf + h->len;
+	Glyph g;
+	uint32_t n;
+	size_t len;
+	int x = 0, y = 0, w;
+
+	for (x = 0; x < col; x++)
+		line[x] = (Glyph){ .u = ' ', .fg = defaultfg, .bg = defaultbg };
+
+	for (x = 0; p < end && y <= sub; ) {
+		n = getvarint(&p);
+		g.mode = getvarint(&p);
+		g.fg = getvarint(&p);
+		g.bg = getvarint(&p);
+		w = (g.mode & ATTR_WIDE) ? 2 : 1;
+		if (w == 2 && col < 2) {
+			/* no room for it anywhere, split it */
+			g.mode &= ~ATTR_WIDE;
+			w = 1;
+		}
+		for (; n--; p += len) {
+			if (x + w > col) {
+				/* the cell left by a wide glyph moved down */
+				if (y == sub && x < col)
+					line[x].mode |= ATTR_WPAD;
+				if (++y > sub)
+					break;
+				x = 0;
+			}
+			if (y < sub) {
+				utf8decodebyte(*p, &len);
+			} else {
+				len = utf8decode((const char *)p, &g.u, UTF_SIZ);
+				line[x] = g;
+				if (w == 2)
+					line[x + 1] = (Glyph){ 0, ATTR_WDUMMY, g.fg, g.bg };
+			}
+			x += w;
+		}
+	}
+	/* an open entry continues on the next row, so a short last row
+	 * ends where a wide glyph was moved down */
+	if (h->open && y == sub) {
+		for (; x < col; x++)
+			line[x].mode |= ATTR_WPAD;
+	}
+
+	if (h->open || sub < histrows(h) - 1)
+		line[col-1].mode |= ATTR_WRAP;
+}
+
+/*
+ * Line y of the view, taking scrollback into account. History rows are
+ * only expanded to glyphs when they are scrolled into view; the visible
+ * ones map to distinct cache slots, so the returned line stays valid
+ * while other rows are looked at.
+ */
+Line
+tline(int y)
+{
+	HistCache *hc;
+	long e;
+	int r, sub;
+
+	if (y >= term.scr)
+		return term.line[y - term.scr];
+
+	r = term.scr - 1 - y;
+	hc = &term.histcache[r % term.row];
+	if (hc->col != term.col) {
+		hc->line = xrealloc(hc->line, term.col * sizeof(Glyph));
+		hc->col = term.col;
+		hc->e = -1;
+	}
+	if (!histrow(r, &e, &sub)) {
+		e = -1;
+		sub = 0;
+	}
+	if (hc->e != e || hc->sub != sub || e < 0) {
+		if (e < 0)
+			histdecode(&(HistLine){ 0 }, 0, hc->line, term.col);
+		else
+			histdecode(&term.hist[e % histsize], sub, hc->line, term.col);
+		hc->e = e;
+		hc->sub = sub;
+	}
+	return hc->line;
+}
+
 int
 tlinelen(int y)
 {
@@ -676,7 +1137,7 @@ highlighturls(void)
 			url_start = match - linestr;
 			for (c = url_start; c < term.col && strchr(urlchars, linestr[c]); c++) {
 				term.line[i][c].mode |= ATTR_URL;
-				tsetdirt(i, c);
+				tsetdirtx(i, c, c);
 			}
 		}
 	}
@@ -694,7 +1155,7 @@ unhighlighturls(void)
 			g = &term.line[i][j];
 			if (g->mode & ATTR_URL) {
 				g->mode &= ~ATTR_URL;
-				tsetdirt(i, j);
+				tsetdirtx(i, j, j);
 			}
 		}
 	}
@@ -878,6 +1339,7 @@ ttynew(const char *line, char *cmd, const char *out, char **args)
 			    line, strerror(errno));
 		dup2(cmdfd, 0);
 		stty(args);
+		fcntl(cmdfd, F_SETFL, fcntl(cmdfd, F_GETFL) | O_NONBLOCK);
 		return cmdfd;
 	}
 
@@ -913,6 +1375,7 @@ ttynew(const char *line, char *cmd, const char *out, char **args)
 #endif
 		close(s);
 		cmdfd = m;
+		fcntl(cmdfd, F_SETFL, fcntl(cmdfd, F_GETFL) | O_NONBLOCK);
 		signal(SIGCHLD, sigchld);
 		break;
 	}
@@ -922,27 +1385,79 @@ ttynew(const char *line, char *cmd, const char *out, char **args)
 size_t
 ttyread(void)
 {
-	static char buf[BUFSIZ];
-	static int buflen = 0;
-	int ret, written;
+	static char *buf;
+	static size_t bufsiz, buflen;
+	size_t total = 0;
+	ssize_t ret;
+	int written, err = 0;
+	fd_set rfd;
+	struct timespec tv = { 0 };
+#ifdef TTYSTATS
+	static struct timespec start;
+	static size_t nbytes, ndrains;
+	struct timespec now;
+	double secs;
+#endif
 
-	/* append read bytes to unprocessed bytes */
-	ret = read(cmdfd, buf+buflen, LEN(buf)-buflen);
+	/*
+	 * Drain everything the shell has written, up to TTY_BUF_MAX bytes,
+	 * so that bulk output is parsed and drawn in large chunks.
+	 */
+	do {
+		if (buflen == bufsiz) {
+			if (bufsiz >= TTY_BUF_MAX)
+				break;
+			bufsiz = bufsiz ? 2 * bufsiz : BUFSIZ;
+			buf = xrealloc(buf, bufsiz);
+		}
 
-	switch (ret) {
+		/* append read bytes to unprocessed bytes */
+		ret = read(cmdfd, buf+buflen, bufsiz-buflen);
+		if (ret < 0 && (errno == EAGAIN || errno == EINTR))
+			break;
+		if (ret <= 0) {
+			/* the shell is gone, parse what it wrote before */
+			err = ret ? errno : -1;
+			break;
+		}
+		buflen += ret;
+		total += ret;
+
+		FD_ZERO(&rfd);
+		FD_SET(cmdfd, &rfd);
+	} while (pselect(cmdfd+1, &rfd, NULL, NULL, &tv, NULL) > 0);
+
+	written = twrite(buf, buflen, 0);
+	buflen -= written;
+	/* keep any incomplete UTF-8 byte sequence for the next call */
+	if (buflen > 0)
+		memmove(buf, buf + written, buflen);
+
+	switch (err) {
 	case 0:
-		exit(0);
+		break;
 	case -1:
-		die("couldn't read from shell: %s\n", strerror(errno));
+		exit(0);
 	default:
-		buflen += ret;
-		written = twrite(buf, buflen, 0);
-		buflen -= written;
-		/* keep any incomplete UTF-8 byte sequence for the next call */
-		if (buflen > 0)
-			memmove(buf, buf + written, buflen);
-		return ret;
+		die("couldn't read from shell: %s\n", strerror(err));
+	}
+
+#ifdef TTYSTATS
+	/* build with CPPFLAGS=-DTTYSTATS to see the read throughput */
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (!nbytes)
+		start = now;
+	nbytes += total;
+	ndrains++;
+	secs = now.tv_sec - start.tv_sec + (now.tv_nsec - start.tv_nsec) / 1E9;
+	if (secs >= 1) {
+		fprintf(stderr, "st: %.0f bytes/s, %zu bytes per drain\n",
+				nbytes / secs, nbytes / ndrains);
+		nbytes = ndrains = 0;
 	}
+#endif
+
+	return total;
 }
 
 void
@@ -979,58 +1494,63 @@ ttywrite(const char *s, size_t n, int may_echo)
 void
 ttywriteraw(const char *s, size_t n)
 {
-	fd_set wfd, rfd;
+	/* queue the bytes behind those still waiting, write what the tty
+	 * takes now and leave the rest to run() */
+	if (n == 0)
+		return;
+	if (wbuflen + n > wbufsiz) {
+		/* leave half of the buffer free, so moves stay rare */
+		if (2 * (wbuflen - wbufoff + n) > wbufsiz) {
+			wbufsiz = 2 * (wbuflen - wbufoff + n);
+			wbuf = xrealloc(wbuf, wbufsiz);
+		}
+		memmove(wbuf, wbuf + wbufoff, wbuflen - wbufoff);
+		wbuflen -= wbufoff;
+		wbufoff = 0;
+	}
+	memcpy(wbuf + wbuflen, s, n);
+	wbuflen += n;
+
+	ttyflush();
+}
+
+int
+ttywritepending(void)
+{
+	return wbufoff < wbuflen;
+}
+
+void
+ttyflush(void)
+{
 	ssize_t r;
-	size_t lim = 256;
+	size_t n;
 
 	/*
 	 * Remember that we are using a pty, which might be a modem line.
-	 * Writing too much will clog the line. That's why we are doing this
-	 * dance.
+	 * Writing too much will clog the line. That's why writes start
+	 * small and only grow while the tty takes all of them.
 	 * FIXME: Migrate the world to Plan 9.
 	 */
-	while (n > 0) {
-		FD_ZERO(&wfd);
-		FD_ZERO(&rfd);
-		FD_SET(cmdfd, &wfd);
-		FD_SET(cmdfd, &rfd);
-
-		/* Check if we can write. */
-		if (pselect(cmdfd+1, &rfd, &wfd, NULL, NULL, NULL) < 0) {
+	while (wbufoff < wbuflen) {
+		n = MIN(wbuflen - wbufoff, wlim);
+		if ((r = write(cmdfd, wbuf + wbufoff, n)) < 0) {
 			if (errno == EINTR)
 				continue;
-			die("select failed: %s\n", strerror(errno));
+			if (errno != EAGAIN)
+				die("write error on tty: %s\n", strerror(errno));
+			r = 0;
 		}
-		if (FD_ISSET(cmdfd, &wfd)) {
-			/*
-			 * Only write the bytes written by ttywrite() or the
-			 * default of 256. This seems to be a reasonable value
-			 * for a serial line. Bigger values might clog the I/O.
-			 */
-			if ((r = write(cmdfd, s, (n < lim)? n : lim)) < 0)
-				goto write_error;
-			if (r < n) {
-				/*
-				 * We weren't able to write out everything.
-				 * This means the buffer is getting full
-				 * again. Empty it.
-				 */
-				if (n < lim)
-					lim = ttyread();
-				n -= r;
-				s += r;
-			} else {
-				/* All bytes have been written. */
-				break;
-			}
+		wbufoff += r;
+		if (r < n) {
+			/* the tty is full, run() calls again once it drains */
+			wlim = TTY_WRITE_MIN;
+			break;
 		}
-		if (FD_ISSET(cmdfd, &rfd))
-			lim = ttyread();
+		wlim = MIN(2 * wlim, TTY_WRITE_MAX);
 	}
-	return;
-
-write_error:
-	die("write error on tty: %s\n", strerror(errno));
+	if (wbufoff == wbuflen)
+		wbufoff = wbuflen = 0;
 }
 
 void
@@ -1057,12 +1577,16 @@ int
 tattrset(int attr)
 {
 	int i, j;
+	ushort m;
 
-	for (i = 0; i < term.row-1; i++) {
-		for (j = 0; j < term.col-1; j++) {
-			if (term.line[i][j].mode & attr)
-				return 1;
-		}
+	for (i = 0; i < term.row; i++) {
+		if (!(term.lattr[i] & attr))
+			continue;
+		for (m = 0, j = 0; j < term.col; j++)
+			m |= term.line[i][j].mode;
+		term.lattr[i] = m;
+		if (m & attr)
+			return 1;
 	}
 
 	return 0;
@@ -1077,30 +1601,77 @@ tsetdirt(int top, int bot)
 	LIMIT(bot, 0, term.row-1);
 
 	for (i = top; i <= bot; i++)
-		term.dirty[i] = 1;
+		term.dirty[i] = (Dirty){ 0, term.col - 1 };
+}
+
+/* mark columns x1 to x2 of line y for redraw */
+void
+tsetdirtx(int y, int x1, int x2)
+{
+	Dirty *d = &term.dirty[y];
+
+	d->x1 = MIN(d->x1, MAX(x1, 0));
+	d->x2 = MAX(d->x2, MIN(x2, term.col - 1));
 }
 
 void
 tsetdirtattr(int attr)
 {
-	int i, j;
+	int i, j, x1, x2;
+	ushort m;
 
-	for (i = 0; i < term.row-1; i++) {
-		for (j = 0; j < term.col-1; j++) {
+	for (i = 0; i < term.row; i++) {
+		if (!(term.lattr[i] & attr))
+			continue;
+		x1 = INT_MAX, x2 = -1;
+		for (m = 0, j = 0; j < term.col; j++) {
+			m |= term.line[i][j].mode;
 			if (term.line[i][j].mode & attr) {
-				tsetdirt(i, i);
-				break;
+				x1 = MIN(x1, j);
+				x2 = j;
 			}
 		}
+		term.lattr[i] = m;
+		if (x1 <= x2)
+			tsetdirtx(i, x1, x2);
 	}
 }
 
 void
 tfulldirt(void)
 {
+	term.nscroll = 0;
 	tsetdirt(0, term.row-1);
 }
 
+/*
+ * Record that lines orig to term.bot moved up by n rows (down if negative),
+ * so that draw() can shift their pixels instead of drawing them again.
+ * Returns 0 if the lines have to be redrawn.
+ */
+int
+tqueuescroll(int orig, int n)
+{
+	Scroll *s;
+
+	if (term.scr > 0 || MAX(n, -n) > term.bot - orig)
+		return 0;
+
+	if (term.nscroll > 0) {
+		s = &term.scroll[term.nscroll - 1];
+		if (s->top == orig && s->bot == term.bot) {
+			s->n += n;
+			return 1;
+		}
+	}
+	if (term.nscroll == LEN(term.scroll)) {
+		tfulldirt();
+		return 0;
+	}
+	term.scroll[term.nscroll++] = (Scroll){ orig, term.bot, n };
+	return 1;
+}
+
 void
 tcursor(int mode)
 {
@@ -1147,6 +1718,11 @@ void
 tnew(int col, int row)
 {
 	term = (Term){ .c = { .attr = { .fg = defaultfg, .bg = defaultbg } } };
+	LIMIT(histsize, 0, INT_MAX / sizeof(*term.hist));
+	if (histsize > 0) {
+		term.hist = xmalloc(histsize * sizeof(*term.hist));
+		memset(term.hist, 0, histsize * sizeof(*term.hist));
+	}
 	tresize(col, row);
 	treset();
 }
@@ -1164,6 +1740,7 @@ tswapscreen(void)
 	term.line = term.alt;
 	term.alt = tmp;
 	term.mode ^= MODE_ALTSCREEN;
+	memset(term.lattr, 0xff, term.row * sizeof(*term.lattr));
 	tfulldirt();
 }
 
@@ -1193,7 +1770,9 @@ kscrollup(const Arg* a)
 	if (n < 0)
 		n = term.row + n;
 
-	if (term.scr <= HISTSIZE-n) {
+	n = histavail(term.scr + n) - term.scr;
+
+	if (n > 0) {
 		term.scr += n;
 		selscroll(0, n);
 		tfulldirt();
@@ -1201,27 +1780,30 @@ kscrollup(const Arg* a)
 }
 
 void
-tscrolldown(int orig, int n, int copyhist)
+tscrolldown(int orig, int n)
 {
 	int i;
 	Line temp;
+	Dirty dtemp;
+	ushort atemp;
 
 	LIMIT(n, 0, term.bot-orig+1);
 
-	if (copyhist) {
-		term.histi = (term.histi - 1 + HISTSIZE) % HISTSIZE;
-		temp = term.hist[term.histi];
-		term.hist[term.histi] = term.line[term.bot];
-		term.line[term.bot] = temp;
-	}
-
-	tsetdirt(orig, term.bot-n);
+	if (!tqueuescroll(orig, -n))
+		tsetdirt(orig, term.bot-n);
 	tclearregion(0, term.bot-n+1, term.col-1, term.bot);
 
+	/* dirty columns move along with their lines */
 	for (i = term.bot; i >= orig+n; i--) {
 		temp = term.line[i];
 		term.line[i] = term.line[i-n];
 		term.line[i-n] = temp;
+		dtemp = term.dirty[i];
+		term.dirty[i] = term.dirty[i-n];
+		term.dirty[i-n] = dtemp;
+		atemp = term.lattr[i];
+		term.lattr[i] = term.lattr[i-n];
+		term.lattr[i-n] = atemp;
 	}
 
 	if (term.scr == 0)
@@ -1231,28 +1813,34 @@ tscrolldown(int orig, int n, int copyhist)
 void
 tscrollup(int orig, int n, int copyhist)
 {
-	int i;
+	int i, added;
 	Line temp;
+	Dirty dtemp;
+	ushort atemp;
 
 	LIMIT(n, 0, term.bot-orig+1);
 
 	if (copyhist) {
-		term.histi = (term.histi + 1) % HISTSIZE;
-		temp = term.hist[term.histi];
-		term.hist[term.histi] = term.line[orig];
-		term.line[orig] = temp;
+		added = histpush(term.line[orig], term.col);
+		/* keep the view where it is while scrolled back */
+		if (term.scr > 0)
+			term.scr = histavail(term.scr + added);
 	}
 
-	if (term.scr > 0 && term.scr < HISTSIZE)
-		term.scr = MIN(term.scr + n, HISTSIZE-1);
-
 	tclearregion(0, orig, term.col-1, orig+n-1);
-	tsetdirt(orig+n, term.bot);
+	if (!tqueuescroll(orig, n))
+		tsetdirt(orig+n, term.bot);
 
 	for (i = orig; i <= term.bot-n; i++) {
 		temp = term.line[i];
 		term.line[i] = term.line[i+n];
 		term.line[i+n] = temp;
+		dtemp = term.dirty[i];
+		term.dirty[i] = term.dirty[i+n];
+		term.dirty[i+n] = dtemp;
+		atemp = term.lattr[i];
+		term.lattr[i] = term.lattr[i+n];
+		term.lattr[i+n] = atemp;
 	}
 
 	if (term.scr == 0)
@@ -1380,12 +1968,14 @@ tsetchar(Rune u, const Glyph *attr, int x, int y)
 		term.line[y][x-1].mode &= ~ATTR_WIDE;
 	}
 
-	term.dirty[y] = 1;
+	/* a wide glyph it cut in half was changed too */
+	tsetdirtx(y, x - 1, x + 1);
 	term.line[y][x] = *attr;
 	term.line[y][x].u = u;
 
 	if (isboxdraw(u))
 		term.line[y][x].mode |= ATTR_BOXDRAW;
+	term.lattr[y] |= term.line[y][x].mode;
 }
 
 void
@@ -1405,7 +1995,7 @@ tclearregion(int x1, int y1, int x2, int y2)
 	LIMIT(y2, 0, term.row-1);
 
 	for (y = y1; y <= y2; y++) {
-		term.dirty[y] = 1;
+		tsetdirtx(y, x1, x2);
 		for (x = x1; x <= x2; x++) {
 			gp = &term.line[y][x];
 			if (selected(x, y))
@@ -1432,6 +2022,7 @@ tdeletechar(int n)
 	line = term.line[term.c.y];
 
 	memmove(&line[dst], &line[src], size * sizeof(Glyph));
+	tsetdirtx(term.c.y, dst, term.col - 1);
 	tclearregion(term.col-n, term.c.y, term.col-1, term.c.y);
 }
 
@@ -1449,6 +2040,7 @@ tinsertblank(int n)
 	line = term.line[term.c.y];
 
 	memmove(&line[dst], &line[src], size * sizeof(Glyph));
+	tsetdirtx(term.c.y, src, term.col - 1);
 	tclearregion(src, term.c.y, dst - 1, term.c.y);
 }
 
@@ -1456,7 +2048,7 @@ void
 tinsertblankline(int n)
 {
 	if (BETWEEN(term.c.y, term.top, term.bot))
-		tscrolldown(term.c.y, n, 0);
+		tscrolldown(term.c.y, n);
 }
 
 void
@@ -1911,7 +2503,7 @@ csihandle(void)
 		break;
 	case 'T': /* SD -- Scroll <n> line down */
 		DEFAULT(csiescseq.arg[0], 1);
-		tscrolldown(term.top, csiescseq.arg[0], 0);
+		tscrolldown(term.top, csiescseq.arg[0]);
 		break;
 	case 'L': /* IL -- Insert <n> blank lines */
 		DEFAULT(csiescseq.arg[0], 1);
@@ -2513,7 +3105,7 @@ eschandle(uchar ascii)
 		break;
 	case 'M': /* RI -- Reverse index */
 		if (term.c.y == term.top) {
-			tscrolldown(term.top, 1, 1);
+			tscrolldown(term.top, 1);
 		} else {
 			tmoveto(term.c.x, term.c.y-1);
 		}
@@ -2556,7 +3148,7 @@ tputc(Rune u)
 {
 	char c[UTF_SIZ];
 	int control;
-	int width, len;
+	int width, len = 0;
 	Glyph *gp;
 
 	control = ISCONTROL(u);
@@ -2564,9 +3156,11 @@ tputc(Rune u)
 		c[0] = u;
 		width = len = 1;
 	} else {
-		len = utf8encode(u, c);
-		if (!control && (width = wcwidth(u)) == -1)
-			width = 1;
+		/* the encoding is only needed by the printer and STR sequences */
+		if (IS_SET(MODE_PRINT) || (term.esc & ESC_STR))
+			len = utf8encode(u, c);
+		if (!control)
+			width = runewidth(u);
 	}
 
 	if (IS_SET(MODE_PRINT))
@@ -2670,6 +3264,7 @@ check_control_code:
 	if (IS_SET(MODE_INSERT) && term.c.x+width < term.col) {
 		memmove(gp+width, gp, (term.col - term.c.x - width) * sizeof(Glyph));
 		gp->mode &= ~ATTR_WIDE;
+		tsetdirtx(term.c.y, term.c.x, term.col - 1);
 	}
 
 	if (term.c.x+width > term.col) {
@@ -2685,6 +3280,7 @@ check_control_code:
 
 	if (width == 2) {
 		gp->mode |= ATTR_WIDE;
+		tsetdirtx(term.c.y, term.c.x, term.c.x + 2);
 		if (term.c.x+1 < term.col) {
 			if (gp[1].mode == ATTR_WIDE && term.c.x+2 < term.col) {
 				gp[2].u = ' ';
@@ -2701,14 +3297,95 @@ check_control_code:
 	}
 }
 
+/*
+ * Write the run of printable ASCII at the start of s straight into the
+ * screen, a row at a time. Only called when tputc() would do nothing but
+ * store the glyphs: no sequence pending, no printer, insert mode or
+ * graphic charset. Returns the nb of bytes written.
+ */
+int
+tputascii(const char *s, int n)
+{
+	Glyph *gp;
+	uint64_t v;
+	int i, j, k, len;
+
+	for (len = 0; len + 8 <= n; len += 8) {
+		memcpy(&v, s + len, 8);
+		if (!ISPRINT8(v))
+			break;
+	}
+	while (len < n && BETWEEN(s[len], 0x20, 0x7e))
+		len++;
+
+	for (i = 0; i < len; i += k) {
+		if (IS_SET(MODE_WRAP) && (term.c.state & CURSOR_WRAPNEXT)) {
+			term.line[term.c.y][term.c.x].mode |= ATTR_WRAP;
+			tnewline(1);
+		}
+		k = MIN(len - i, term.col - term.c.x);
+		if (sel.ob.x != -1) {
+			for (j = 0; j < k && !selected(term.c.x + j, term.c.y); j++)
+				;
+			if (j < k)
+				selclear();
+		}
+
+		/* wide glyphs cut in half by the run */
+		gp = &term.line[term.c.y][term.c.x];
+		if ((gp->mode & ATTR_WDUMMY) && term.c.x > 0) {
+			gp[-1].u = ' ';
+			gp[-1].mode &= ~ATTR_WIDE;
+		}
+		if ((gp[k-1].mode & ATTR_WIDE) && term.c.x + k < term.col) {
+			gp[k].u = ' ';
+			gp[k].mode &= ~ATTR_WDUMMY;
+		}
+
+		for (j = 0; j < k; j++) {
+			gp[j] = term.c.attr;
+			gp[j].u = s[i + j];
+		}
+		term.lattr[term.c.y] |= term.c.attr.mode;
+		tsetdirtx(term.c.y, term.c.x - 1, term.c.x + k);
+
+		if (term.c.x + k < term.col) {
+			tmoveto(term.c.x + k, term.c.y);
+		} else {
+			tmoveto(term.col - 1, term.c.y);
+			term.c.state |= CURSOR_WRAPNEXT;
+		}
+	}
+	term.lastc = s[len - 1];
+
+	return len;
+}
+
 int
 twrite(const char *buf, int buflen, int show_ctrl)
 {
 	int charsize;
-	Rune u;
-	int n;
+	Rune u, run[256];
+	int i, n, nr;
 
 	for (n = 0; n < buflen; n += charsize) {
+		if (!show_ctrl && !term.esc && BETWEEN(buf[n], 0x20, 0x7e)
+		    && !IS_SET(MODE_PRINT) && !IS_SET(MODE_INSERT)
+		    && term.trantbl[term.charset] != CS_GRAPHIC0) {
+			charsize = tputascii(buf + n, buflen - n);
+			continue;
+		}
+		/*
+		 * Only an ASCII escape sequence can leave UTF-8 mode, so a
+		 * run of non-ASCII chars is decoded up front.
+		 */
+		if (!show_ctrl && IS_SET(MODE_UTF8) && (buf[n] & 0x80)
+		    && (charsize = utf8decoderun(buf + n, buflen - n, run,
+		                                 LEN(run), &nr))) {
+			for (i = 0; i < nr; i++)
+				tputc(run[i]);
+			continue;
+		}
 		if (IS_SET(MODE_UTF8)) {
 			/* process a complete utf8 char */
 			charsize = utf8decode(buf + n, &u, buflen - n);
@@ -2733,12 +3410,148 @@ twrite(const char *buf, int buflen, int show_ctrl)
 	return n;
 }
 
+/*
+ * Rewrap the main screen to col columns and row rows: rows joined by
+ * ATTR_WRAP are laid out again, rows that no longer fit are pushed to
+ * history and the cursor stays on the cell it was on. History itself is
+ * rewrapped by histrow() as it is scrolled into view.
+ */
+void
+treflow(int col, int row)
+{
+	HistLine *h;
+	Line *src, *nl = NULL;
+	Glyph g, blank = { .u = ' ', .fg = term.c.attr.fg, .bg = term.c.attr.bg };
+	int y, x, i, w, len, last, next, off, nsrc, pulled = 0, nn = 0, cap = 0;
+	int nx = 0, cx = 0, cy = 0;
+
+	selclear();
+
+	/* the first row may continue the newest history entry, take it back */
+	h = term.histn > 0 ? &term.hist[(term.histpushed - 1) % histsize] : NULL;
+	if (h && h->open)
+		pulled = histrows(h);
+	nsrc = pulled + term.row;
+	src = xmalloc(nsrc * sizeof(Line));
+	for (i = 0; i < pulled; i++) {
+		src[i] = xmalloc(term.col * sizeof(Glyph));
+		histdecode(h, i, src[i], term.col);
+	}
+	if (pulled) {
+		free(h->buf);
+		*h = (HistLine){ 0 };
+		term.histpushed--;
+		term.histn--;
+	}
+	memcpy(src + pulled, term.line, term.row * sizeof(Line));
+
+	/* keep rows down to the cursor or the last non-blank one */
+	for (last = nsrc - 1; last > pulled + term.c.y; last--) {
+		for (x = 0; x < term.col && glyphblank(&src[last][x]); x++)
+			;
+		if (x < term.col)
+			break;
+	}
+
+	for (y = 0; y <= last; y = next) {
+		/* one logical line: rows y to next-1 */
+		for (next = y + 1; next <= last
+		     && (src[next-1][term.col-1].mode & ATTR_WRAP); next++)
+			;
+		len = (next - y) * term.col;
+		while (len > 0 && glyphblank(&src[y + (len-1) / term.col][(len-1) % term.col]))
+			len--;
+		off = -1;
+		if (BETWEEN(pulled + term.c.y, y, next - 1)) {
+			off = (pulled + term.c.y - y) * term.col + term.c.x;
+			len = MAX(len, off + 1);
+		}
+
+		for (i = 0; i < len || i == 0; i++) {
+			if (i == 0 || nx + 1 > col) {
+				if (i > 0)
+					nl[nn-1][col-1].mode |= ATTR_WRAP;
+				if (nn == cap) {
+					cap = cap ? cap * 2 : row;
+					nl = xrealloc(nl, cap * sizeof(Line));
+				}
+				nl[nn] = xmalloc(col * sizeof(Glyph));
+				for (x = 0; x < col; x++)
+					nl[nn][x] = blank;
+				nn++;
+				nx = 0;
+			}
+			if (i >= len)
+				break;
+
+			g = src[y + i / term.col][i % term.col];
+			if (g.mode & ATTR_WPAD) {
+				/* left by an earlier move, not content */
+				if (i == off)
+					len = MAX(len, ++off + 1);
+				continue;
+			}
+			g.mode &= ~ATTR_WRAP;
+			w = ((g.mode & ATTR_WIDE) && i + 1 < len) ? 2 : 1;
+			if (w == 2 && col < 2) {
+				/* no room for it anywhere, split it */
+				g.mode &= ~ATTR_WIDE;
+				w = 1;
+			}
+			if (nx + w > col) {
+				/* wide glyph at the last column, move it down */
+				nl[nn-1][nx].mode |= ATTR_WPAD;
+				i--;
+				nx = col;
+				continue;
+			}
+			if (i == off || (w == 2 && i + 1 == off))
+				cx = nx + (i + 1 == off), cy = nn - 1;
+			nl[nn-1][nx++] = g;
+			if (w == 2) {
+				g = src[y + (i+1) / term.col][(i+1) % term.col];
+				g.mode &= ~ATTR_WRAP;
+				nl[nn-1][nx++] = g;
+				i++;
+			}
+		}
+	}
+
+	/* what does not fit goes to history */
+	for (i = 0; i < nn - row; i++) {
+		histpush(nl[i], col);
+		free(nl[i]);
+	}
+	if (i > 0) {
+		memmove(nl, nl + i, (nn - i) * sizeof(Line));
+		nn -= i;
+		cy = MAX(cy - i, 0);
+	}
+	nl = xrealloc(nl, row * sizeof(Line));
+	for (; nn < row; nn++) {
+		nl[nn] = xmalloc(col * sizeof(Glyph));
+		for (x = 0; x < col; x++)
+			nl[nn][x] = blank;
+	}
+
+	for (y = 0; y < nsrc; y++)
+		free(src[y]);
+	free(src);
+	free(term.line);
+	term.line = nl;
+	term.c.x = cx;
+	term.c.y = cy;
+	term.scr = 0;
+	term.histw = 0;
+}
+
 void
 tresize(int col, int row)
 {
-	int i, j;
+	int i;
 	int minrow = MIN(row, term.row);
 	int mincol = MIN(col, term.col);
+	int reflow = term.row > 0 && col != term.col && !IS_SET(MODE_ALTSCREEN);
 	int *bp;
 	TCursor c;
 
@@ -2748,12 +3561,18 @@ tresize(int col, int row)
 		return;
 	}
 
+	/* the main screen is laid out again, the alternate one is cut */
+	if (reflow)
+		treflow(col, row);
+
 	/*
 	 * slide screen to keep cursor where we expect it -
 	 * tscrollup would work here, but we can optimize to
 	 * memmove because we're freeing the earlier lines
 	 */
 	for (i = 0; i <= term.c.y - row; i++) {
+		if (!IS_SET(MODE_ALTSCREEN))
+			histpush(term.line[i], term.col);
 		free(term.line[i]);
 		free(term.alt[i]);
 	}
@@ -2763,33 +3582,30 @@ tresize(int col, int row)
 		memmove(term.alt, term.alt + i, row * sizeof(Line));
 	}
 	for (i += row; i < term.row; i++) {
-		free(term.line[i]);
+		if (!reflow)
+			free(term.line[i]);
 		free(term.alt[i]);
 	}
 
 	/* resize to new height */
-	term.line = xrealloc(term.line, row * sizeof(Line));
+	if (!reflow)
+		term.line = xrealloc(term.line, row * sizeof(Line));
 	term.alt  = xrealloc(term.alt,  row * sizeof(Line));
 	term.dirty = xrealloc(term.dirty, row * sizeof(*term.dirty));
+	term.lattr = xrealloc(term.lattr, row * sizeof(*term.lattr));
 	term.tabs = xrealloc(term.tabs, col * sizeof(*term.tabs));
 
-	for (i = 0; i < HISTSIZE; i++) {
-		term.hist[i] = xrealloc(term.hist[i], col * sizeof(Glyph));
-		for (j = mincol; j < col; j++) {
-			term.hist[i][j] = term.c.attr;
-			term.hist[i][j].u = ' ';
-		}
-	}
-
 	/* resize each row to new width, zero-pad if needed */
 	for (i = 0; i < minrow; i++) {
-		term.line[i] = xrealloc(term.line[i], col * sizeof(Glyph));
+		if (!reflow)
+			term.line[i] = xrealloc(term.line[i], col * sizeof(Glyph));
 		term.alt[i]  = xrealloc(term.alt[i],  col * sizeof(Glyph));
 	}
 
 	/* allocate any new rows */
 	for (/* i = minrow */; i < row; i++) {
-		term.line[i] = xmalloc(col * sizeof(Glyph));
+		if (!reflow)
+			term.line[i] = xmalloc(col * sizeof(Glyph));
 		term.alt[i] = xmalloc(col * sizeof(Glyph));
 	}
 	if (col > term.col) {
@@ -2801,6 +3617,13 @@ tresize(int col, int row)
 		for (bp += tabspaces; bp < term.tabs + col; bp += tabspaces)
 			*bp = 1;
 	}
+	/* expanded history lines are kept per row */
+	for (i = 0; i < term.row; i++)
+		free(term.histcache[i].line);
+	term.histcache = xrealloc(term.histcache, row * sizeof(*term.histcache));
+	for (i = 0; i < row; i++)
+		term.histcache[i] = (HistCache){ .e = -1 };
+
 	/* update terminal size */
 	term.col = col;
 	term.row = row;
@@ -2811,10 +3634,10 @@ tresize(int col, int row)
 	/* Clearing both screens (it makes dirty all lines) */
 	c = term.c;
 	for (i = 0; i < 2; i++) {
-		if (mincol < col && 0 < minrow) {
+		if (mincol < col && 0 < minrow && !(reflow && i == 0)) {
 			tclearregion(mincol, 0, col - 1, minrow - 1);
 		}
-		if (0 < col && minrow < row) {
+		if (0 < col && minrow < row && !(reflow && i == 0)) {
 			tclearregion(0, minrow, col - 1, row - 1);
 		}
 		tswapscreen();
@@ -2832,14 +3655,31 @@ resettitle(void)
 void
 drawregion(int x1, int y1, int x2, int y2)
 {
-	int y;
+	Line line;
+	Dirty *d;
+	int y, xa, xb;
 
 	for (y = y1; y < y2; y++) {
-		if (!term.dirty[y])
+		d = &term.dirty[y];
+		if (d->x1 > d->x2)
 			continue;
 
-		term.dirty[y] = 0;
-		xdrawline(TLINE(y), x1, y, x2);
+		line = TLINE(y);
+		xa = MAX(d->x1, x1);
+		xb = MIN(d->x2 + 1, x2);
+		*d = (Dirty){ INT_MAX, -1 };
+
+		/* whole wide glyphs, and italics that may lean over the span */
+		if (xa > x1 && (line[xa].mode & ATTR_WDUMMY))
+			xa--;
+		while (xa > x1 && (line[xa-1].mode & ATTR_ITALIC))
+			xa--;
+		if (xb < x2 && (line[xb-1].mode & ATTR_WIDE))
+			xb++;
+		while (xb < x2 && (line[xb-1].mode & ATTR_ITALIC))
+			xb++;
+		if (xa < xb)
+			xdrawline(line, xa, y, xb);
 	}
 }
 
@@ -2847,6 +3687,8 @@ void
 draw(void)
 {
 	int cx = term.c.x, ocx = term.ocx, ocy = term.ocy;
+	int i, oy;
+	Scroll *s;
 
 	if (!xstartdraw())
 		return;
@@ -2859,6 +3701,22 @@ draw(void)
 	if (term.line[term.c.y][cx].mode & ATTR_WDUMMY)
 		cx--;
 
+	/* shift what was drawn before, and the old cursor with it */
+	oy = term.ocy;
+	for (i = 0; i < term.nscroll; i++) {
+		s = &term.scroll[i];
+		if (BETWEEN(oy, s->top, s->bot)) {
+			oy -= s->n;
+			if (!BETWEEN(oy, s->top, s->bot))
+				oy = -1;
+		}
+		if (MAX(s->n, -s->n) <= s->bot - s->top)
+			xscroll(s->top, s->bot, s->n);
+	}
+	term.nscroll = 0;
+	if (oy >= 0)
+		tsetdirtx(oy, term.ocx, term.ocx + 1);
+
 	drawregion(0, 0, term.col, term.row);
 	if (term.scr == 0)
 		xdrawcursor(cx, term.c.y, term.line[term.c.y][cx],
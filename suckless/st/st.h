@@ -34,6 +34,7 @@ enum glyph_attribute {
 	ATTR_WIDE       = 1 << 9,
 	ATTR_WDUMMY     = 1 << 10,
 	ATTR_BOXDRAW    = 1 << 11,
+	ATTR_WPAD       = 1 << 12,
 	ATTR_BOLD_FAINT = ATTR_BOLD | ATTR_FAINT,
 	ATTR_URL        = 1 << 14,
 };
@@ -98,6 +99,8 @@ void tsetdirtattr(int);
 void ttyhangup(void);
 int ttynew(const char *, char *, const char *, char **);
 size_t ttyread(void);
+void ttyflush(void);
+int ttywritepending(void);
 void ttyresize(int, int);
 void ttywrite(const char *, size_t, int);
 
@@ -138,6 +141,7 @@ extern int allowaltscreen;
 extern int allowwindowops;
 extern char *termname;
 extern unsigned int tabspaces;
+extern int histsize;
 extern unsigned int defaultfg;
 extern unsigned int defaultbg;
 extern unsigned int defaultcs;
@@ -146,3 +150,5 @@ extern char *urlhandler;
 extern char urlchars[];
 extern char *urlprefixes[];
 extern int nurlprefixes;
+extern const Rune privatewidths[][3];
+extern const int nprivatewidths;
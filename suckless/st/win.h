@@ -31,6 +31,7 @@ void xfinishdraw(void);
 void xloadcols(void);
 int xsetcolorname(int, const char *);
 int xgetcolor(int, unsigned char *, unsigned char *, unsigned char *);
+void xscroll(int, int, int);
 void xseticontitle(char *);
 void xsettitle(char *);
 int xsetcursor(int);
@@ -108,6 +108,7 @@ typedef struct {
 	Colormap cmap;
 	Window win;
 	Drawable buf;
+	Region damage; /* parts of buf drawn since the last copy to win */
 	GlyphFontSpec *specbuf; /* font spec buffer used for rendering */
 	Atom xembed, wmdeletewin, netwmname, netwmiconname, netwmpid;
 	struct {
@@ -162,6 +163,8 @@ static int xmakeglyphfontspecs(XftGlyphFontSpec *, const Glyph *, int, int, int)
 static void xdrawglyphfontspecs(const XftGlyphFontSpec *, Glyph, int, int, int);
 static void xdrawglyph(Glyph, int, int);
 static void xclear(int, int, int, int);
+static Color *xcachecolor(const XRenderColor *);
+static void xdamage(int, int, int, int);
 static int xgeommasktogravity(int);
 static int ximopen(Display *);
 static void ximinstantiate(Display *, XPointer, XPointer);
@@ -259,6 +262,26 @@ typedef struct {
 static Fontcache *frc = NULL;
 static int frclen = 0;
 static int frccap = 0;
+
+/* Glyph lookups by rune and FRC_ style, direct mapped. */
+typedef struct {
+	XftFont *font; /* NULL if unused */
+	FT_UInt glyph;
+	Rune rune;
+	int flags;
+} Glyphcache;
+
+static Glyphcache gcache[4096];
+
+/* Colors allocated outside the palette, 64 sets of 4 with LRU eviction. */
+typedef struct {
+	uint64_t key;  /* rgba */
+	unsigned long used; /* 0 if unused */
+	Color col;
+} Colorcache;
+
+static Colorcache ccache[64][4];
+static unsigned long ccacheclock;
 static char *usedfont = NULL;
 static double usedfontsize = 0;
 static double defaultfontsize = 0;
@@ -789,6 +812,7 @@ xresize(int col, int row)
 			xw.depth);
 	XftDrawChange(xw.draw, xw.buf);
 	xclear(0, 0, win.w, win.h);
+	xdamage(0, 0, win.w, win.h);
 
 	/* resize to new width */
 	xw.specbuf = xrealloc(xw.specbuf, col * sizeof(GlyphFontSpec));
@@ -900,6 +924,43 @@ xclear(int x1, int y1, int x2, int y2)
 			x1, y1, x2-x1, y2-y1);
 }
 
+Color *
+xcachecolor(const XRenderColor *c)
+{
+	uint64_t key = (uint64_t)c->red << 48 | (uint64_t)c->green << 32 |
+	               (uint64_t)c->blue << 16 | c->alpha;
+	Colorcache *set = ccache[(key * 0x9e3779b97f4a7c15ULL) >> 58], *e;
+	int i;
+
+	e = &set[0];
+	for (i = 0; i < LEN(ccache[0]); i++) {
+		if (set[i].used && set[i].key == key) {
+			set[i].used = ++ccacheclock;
+			return &set[i].col;
+		}
+		if (set[i].used < e->used)
+			e = &set[i];
+	}
+
+	if (e->used)
+		XftColorFree(xw.dpy, xw.vis, xw.cmap, &e->col);
+	if (!XftColorAllocValue(xw.dpy, xw.vis, xw.cmap, c, &e->col)) {
+		e->used = 0;
+		return &dc.col[defaultfg];
+	}
+	e->key = key;
+	e->used = ++ccacheclock;
+	return &e->col;
+}
+
+void
+xdamage(int x, int y, int w, int h)
+{
+	XRectangle r = { x, y, w, h };
+
+	XUnionRectWithRegion(&r, xw.damage, xw.damage);
+}
+
 void
 xhints(void)
 {
@@ -1204,6 +1265,7 @@ xunloadfonts(void)
 	/* Free the loaded fonts in the font cache.  */
 	while (frclen > 0)
 		XftFontClose(xw.dpy, frc[--frclen].font);
+	memset(gcache, 0, sizeof(gcache));
 
 	xunloadfont(&dc.font);
 	xunloadfont(&dc.bfont);
@@ -1337,6 +1399,7 @@ xinit(int cols, int rows)
 			xw.depth);
 	XSetForeground(xw.dpy, dc.gc, dc.col[defaultbg].pixel);
 	XFillRectangle(xw.dpy, xw.buf, dc.gc, 0, 0, win.w, win.h);
+	xw.damage = XCreateRegion();
 
 	/* font spec buffer */
 	xw.specbuf = xmalloc(cols * sizeof(GlyphFontSpec));
@@ -1409,6 +1472,7 @@ xmakeglyphfontspecs(XftGlyphFontSpec *specs, const Glyph *glyphs, int len, int x
 	FcPattern *fcpattern, *fontpattern;
 	FcFontSet *fcsets[] = { NULL };
 	FcCharSet *fccharset;
+	Glyphcache *gc;
 	int i, f, numspecs = 0;
 
 	for (i = 0, xp = winx, yp = winy + font->ascent; i < len; ++i) {
@@ -1442,11 +1506,26 @@ xmakeglyphfontspecs(XftGlyphFontSpec *specs, const Glyph *glyphs, int len, int x
 		if (mode & ATTR_BOXDRAW) {
 			/* minor shoehorning: boxdraw uses only this ushort */
 			glyphidx = boxdrawindex(&glyphs[i]);
+			gc = NULL;
 		} else {
+			/* The glyph may have been looked up before. */
+			gc = &gcache[(rune * 4 + frcflags) % LEN(gcache)];
+			if (gc->font && gc->rune == rune && gc->flags == frcflags) {
+				specs[numspecs].font = gc->font;
+				specs[numspecs].glyph = gc->glyph;
+				specs[numspecs].x = (short)xp;
+				specs[numspecs].y = (short)yp;
+				xp += runewidth;
+				numspecs++;
+				continue;
+			}
+
 			/* Lookup character index with default font. */
 			glyphidx = XftCharIndex(xw.dpy, font->match, rune);
 		}
 		if (glyphidx) {
+			if (gc)
+				*gc = (Glyphcache){ font->match, glyphidx, rune, frcflags };
 			specs[numspecs].font = font->match;
 			specs[numspecs].glyph = glyphidx;
 			specs[numspecs].x = (short)xp;
@@ -1521,6 +1600,8 @@ xmakeglyphfontspecs(XftGlyphFontSpec *specs, const Glyph *glyphs, int len, int x
 			FcCharSetDestroy(fccharset);
 		}
 
+		if (gc)
+			*gc = (Glyphcache){ frc[f].font, glyphidx, rune, frcflags };
 		specs[numspecs].font = frc[f].font;
 		specs[numspecs].glyph = glyphidx;
 		specs[numspecs].x = (short)xp;
@@ -1538,7 +1619,7 @@ xdrawglyphfontspecs(const XftGlyphFontSpec *specs, Glyph base, int len, int x, i
 	int charlen = len * ((base.mode & ATTR_WIDE) ? 2 : 1);
 	int winx = win.hborderpx + x * win.cw, winy = win.vborderpx + y * win.ch,
 	    width = charlen * win.cw;
-	Color *fg, *bg, *temp, revfg, revbg, truefg, truebg;
+	Color *fg, *bg, *temp;
 	XRenderColor colfg, colbg;
 	XRectangle r;
 
@@ -1556,8 +1637,7 @@ xdrawglyphfontspecs(const XftGlyphFontSpec *specs, Glyph base, int len, int x, i
 		colfg.red = TRUERED(base.fg);
 		colfg.green = TRUEGREEN(base.fg);
 		colfg.blue = TRUEBLUE(base.fg);
-		XftColorAllocValue(xw.dpy, xw.vis, xw.cmap, &colfg, &truefg);
-		fg = &truefg;
+		fg = xcachecolor(&colfg);
 	} else {
 		fg = &dc.col[base.fg];
 	}
@@ -1567,8 +1647,7 @@ xdrawglyphfontspecs(const XftGlyphFontSpec *specs, Glyph base, int len, int x, i
 		colbg.green = TRUEGREEN(base.bg);
 		colbg.red = TRUERED(base.bg);
 		colbg.blue = TRUEBLUE(base.bg);
-		XftColorAllocValue(xw.dpy, xw.vis, xw.cmap, &colbg, &truebg);
-		bg = &truebg;
+		bg = xcachecolor(&colbg);
 	} else {
 		bg = &dc.col[base.bg];
 	}
@@ -1581,9 +1660,7 @@ xdrawglyphfontspecs(const XftGlyphFontSpec *specs, Glyph base, int len, int x, i
 			colfg.green = ~fg->color.green;
 			colfg.blue = ~fg->color.blue;
 			colfg.alpha = fg->color.alpha;
-			XftColorAllocValue(xw.dpy, xw.vis, xw.cmap, &colfg,
-					&revfg);
-			fg = &revfg;
+			fg = xcachecolor(&colfg);
 		}
 
 		if (bg == &dc.col[defaultbg]) {
@@ -1593,9 +1670,7 @@ xdrawglyphfontspecs(const XftGlyphFontSpec *specs, Glyph base, int len, int x, i
 			colbg.green = ~bg->color.green;
 			colbg.blue = ~bg->color.blue;
 			colbg.alpha = bg->color.alpha;
-			XftColorAllocValue(xw.dpy, xw.vis, xw.cmap, &colbg,
-					&revbg);
-			bg = &revbg;
+			bg = xcachecolor(&colbg);
 		}
 	}
 
@@ -1604,8 +1679,7 @@ xdrawglyphfontspecs(const XftGlyphFontSpec *specs, Glyph base, int len, int x, i
 		colfg.green = fg->color.green / 2;
 		colfg.blue = fg->color.blue / 2;
 		colfg.alpha = fg->color.alpha;
-		XftColorAllocValue(xw.dpy, xw.vis, xw.cmap, &colfg, &revfg);
-		fg = &revfg;
+		fg = xcachecolor(&colfg);
 	}
 
 	if (base.mode & ATTR_REVERSE) {
@@ -1637,6 +1711,11 @@ xdrawglyphfontspecs(const XftGlyphFontSpec *specs, Glyph base, int len, int x, i
 
 	/* Clean up the region we want to draw to. */
 	XftDrawRect(xw.draw, bg, winx, winy, width, win.ch);
+	xdamage((x == 0) ? 0 : winx, (y == 0) ? 0 : winy,
+		((winx + width >= win.hborderpx + win.tw) ? win.w : winx + width)
+			- ((x == 0) ? 0 : winx),
+		((winy + win.ch >= win.vborderpx + win.th) ? win.h : winy + win.ch)
+			- ((y == 0) ? 0 : winy));
 
 	/* Set the clip region because Xft is sometimes dirty. */
 	r.x = 0;
@@ -1761,6 +1840,8 @@ xdrawcursor(int cx, int cy, Glyph g, int ox, int oy, Glyph og)
 				win.vborderpx + (cy + 1) * win.ch - 1,
 				win.cw, 1);
 	}
+	xdamage(win.hborderpx + cx * win.cw, win.vborderpx + cy * win.ch,
+		win.cw, win.ch);
 }
 
 void
@@ -1843,11 +1924,37 @@ xdrawline(Line line, int x1, int y1, int x2)
 		xdrawglyphfontspecs(specs, base, i, ox, y1);
 }
 
+void
+xscroll(int top, int bot, int n)
+{
+	int y = win.vborderpx + top * win.ch, h = (bot - top + 1) * win.ch;
+	int d = n * win.ch;
+
+	/* move rows top to bot of buf by n, up if positive */
+	if (n > 0)
+		XCopyArea(xw.dpy, xw.buf, xw.buf, dc.gc, 0, y + d, win.w,
+				h - d, 0, y);
+	else
+		XCopyArea(xw.dpy, xw.buf, xw.buf, dc.gc, 0, y, win.w,
+				h + d, 0, y - d);
+	xdamage(0, y, win.w, h);
+}
+
 void
 xfinishdraw(void)
 {
-	XCopyArea(xw.dpy, xw.buf, xw.win, dc.gc, 0, 0, win.w,
-			win.h, 0, 0);
+	XRectangle r;
+
+	/* only copy what was drawn */
+	if (!XEmptyRegion(xw.damage)) {
+		XClipBox(xw.damage, &r);
+		XSetRegion(xw.dpy, dc.gc, xw.damage);
+		XCopyArea(xw.dpy, xw.buf, xw.win, dc.gc, r.x, r.y, r.width,
+				r.height, r.x, r.y);
+		XSetClipMask(xw.dpy, dc.gc, None);
+		XDestroyRegion(xw.damage);
+		xw.damage = XCreateRegion();
+	}
 	XSetForeground(xw.dpy, dc.gc,
 			dc.col[IS_SET(MODE_REVERSE)?
 				defaultfg : defaultbg].pixel);
@@ -2094,7 +2201,7 @@ run(void)
 {
 	XEvent ev;
 	int w = win.w, h = win.h;
-	fd_set rfd;
+	fd_set rfd, wfd;
 	int xfd = XConnectionNumber(xw.dpy), ttyfd, xev, drawing;
 	struct timespec seltv, *tv, now, lastblink, trigger;
 	double timeout;
@@ -2122,6 +2229,10 @@ run(void)
 		FD_ZERO(&rfd);
 		FD_SET(ttyfd, &rfd);
 		FD_SET(xfd, &rfd);
+		/* pastes too big for the tty are written as it drains */
+		FD_ZERO(&wfd);
+		if (ttywritepending())
+			FD_SET(ttyfd, &wfd);
 
 		if (XPending(xw.dpy))
 			timeout = 0;  /* existing events might not set xfd */
@@ -2130,7 +2241,7 @@ run(void)
 		seltv.tv_nsec = 1E6 * (timeout - 1E3 * seltv.tv_sec);
 		tv = timeout >= 0 ? &seltv : NULL;
 
-		if (pselect(MAX(xfd, ttyfd)+1, &rfd, NULL, NULL, tv, NULL) < 0) {
+		if (pselect(MAX(xfd, ttyfd)+1, &rfd, &wfd, NULL, tv, NULL) < 0) {
 			if (errno == EINTR)
 				continue;
 			die("select failed: %s\n", strerror(errno));
@@ -2139,6 +2250,8 @@ run(void)
 
 		if (FD_ISSET(ttyfd, &rfd))
 			ttyread();
+		if (FD_ISSET(ttyfd, &wfd))
+			ttyflush();
 
 		xev = 0;
 		while (XPending(xw.dpy)) {